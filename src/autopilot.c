@@ -0,0 +1,372 @@
+#include "autopilot.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_layout.h"
+#include "linked_list.h"
+#include "neighbor_table.h"
+#include "rules.h"
+
+#define NO_CELL NO_NEIGHBOR
+
+// Search goals for `search`.
+enum goal { GOAL_FOOD, GOAL_CELL, GOAL_NONE };
+
+/** Allocates the search buffers for a board of the given size.
+ * Returns 0 on success and -1 if memory could not be allocated.
+ * Arguments:
+ *  - ap: the autopilot to initialize.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+int autopilot_init(autopilot_t* ap, size_t width, size_t height) {
+    size_t count = width * height;
+
+    ap->width = width;
+    ap->height = height;
+    ap->seen = calloc(count, sizeof(unsigned));
+    ap->blocked = calloc(count, sizeof(unsigned));
+    ap->freed = calloc(count, sizeof(unsigned));
+    ap->parent = malloc(count * sizeof(unsigned));
+    ap->frontier = malloc(count * sizeof(unsigned));
+    ap->body = malloc(count * sizeof(unsigned));
+    ap->neighbors = neighbor_table_acquire(width, height);
+    ap->seen_epoch = 0;
+    ap->blocked_epoch = 0;
+    ap->reached = 0;
+    ap->regions = NULL;
+    ap->distances = NULL;
+
+    if (!ap->seen || !ap->blocked || !ap->freed || !ap->parent ||
+        !ap->frontier || !ap->body || !ap->neighbors) {
+        autopilot_free(ap);
+        return -1;
+    }
+    return 0;
+}
+
+/** Frees the search buffers of the given autopilot. */
+void autopilot_free(autopilot_t* ap) {
+    free(ap->seen);
+    free(ap->blocked);
+    free(ap->freed);
+    free(ap->parent);
+    free(ap->frontier);
+    free(ap->body);
+    neighbor_table_release(ap->neighbors);
+    ap->seen = NULL;
+    ap->blocked = NULL;
+    ap->freed = NULL;
+    ap->parent = NULL;
+    ap->frontier = NULL;
+    ap->body = NULL;
+    ap->neighbors = NULL;
+}
+
+/** Advances a stamp epoch, clearing the stamps when the counter wraps so that
+ * stale stamps can never match. Returns the new epoch.
+ */
+static unsigned next_epoch(unsigned* epoch, unsigned* stamps, size_t count) {
+    if (*epoch == UINT_MAX) {
+        memset(stamps, 0, count * sizeof(unsigned));
+        *epoch = 0;
+    }
+    return ++*epoch;
+}
+
+/** Starts a new set of blocked/freed overrides. */
+static void reset_overrides(autopilot_t* ap) {
+    size_t count = ap->width * ap->height;
+    if (ap->blocked_epoch == UINT_MAX) {
+        memset(ap->freed, 0, count * sizeof(unsigned));
+    }
+    next_epoch(&ap->blocked_epoch, ap->blocked, count);
+}
+
+/** Breadth-first search from `start` over free cells. The `tail` cell counts
+ * as free, since it moves out of the way on the same step the head moves in,
+ * and so does any cell stamped in `freed`.
+ * Returns the first cell matching the goal, or NO_CELL if there is none (in
+ * which case `ap->reached` holds the size of the explored region).
+ * Arguments:
+ *  - goal/target: what to look for; `target` is only used with GOAL_CELL.
+ *  - tail: index of the snake's tail cell, or NO_CELL if it stays put.
+ *  - banned_dir: direction that may not be taken from `start`, or -1.
+ */
+static unsigned search(autopilot_t* ap, const int* cells, unsigned start,
+                       enum goal goal, unsigned target, unsigned tail,
+                       int banned_dir) {
+    unsigned epoch =
+        next_epoch(&ap->seen_epoch, ap->seen, ap->width * ap->height);
+    size_t head = 0;
+    size_t tail_q = 0;
+
+    ap->seen[start] = epoch;
+    ap->parent[start] = start;
+    ap->frontier[tail_q++] = start;
+
+    while (head < tail_q) {
+        unsigned current = ap->frontier[head++];
+
+        for (int dir = 0; dir < 4; dir++) {
+            if (current == start && dir == banned_dir) {
+                continue;
+            }
+            unsigned next = neighbor_of(ap->neighbors, current, dir);
+            if (next == NO_CELL || ap->seen[next] == epoch ||
+                ap->blocked[next] == ap->blocked_epoch) {
+                continue;
+            }
+            int cell = cell_flag_at(cells, ap->width, next);
+            if (cell != FLAG_PLAIN_CELL && cell != FLAG_FOOD && next != tail &&
+                ap->freed[next] != ap->blocked_epoch) {
+                continue;
+            }
+
+            ap->seen[next] = epoch;
+            ap->parent[next] = current;
+            if ((goal == GOAL_FOOD && cell == FLAG_FOOD) ||
+                (goal == GOAL_CELL && next == target)) {
+                ap->reached = tail_q;
+                return next;
+            }
+            ap->frontier[tail_q++] = next;
+        }
+    }
+
+    ap->reached = tail_q;
+    return NO_CELL;
+}
+
+/** Walks the parent links back from `found` to `start`, storing the path in
+ * `ap->frontier` (`found` first, the cell next to `start` last). Returns the
+ * number of steps on the path.
+ */
+static size_t trace_path(autopilot_t* ap, unsigned start, unsigned found) {
+    size_t steps = 0;
+    for (unsigned current = found; current != start;
+         current = ap->parent[current]) {
+        ap->frontier[steps++] = current;
+    }
+    return steps;
+}
+
+/** Reads a shortest path to food off the distance field, starting with a
+ * step from `start` in any direction but `banned_dir`, and stores it in
+ * `ap->frontier` the way `trace_path` does. Returns the number of steps, or
+ * 0 if no food can be reached. Unlike `search`, the path never goes through
+ * the tail.
+ */
+static size_t descend(autopilot_t* ap, unsigned start, int banned_dir) {
+    const distance_field_t* df = ap->distances;
+    unsigned first = NO_CELL;
+    unsigned best = DISTANCE_NONE;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = neighbor_of(ap->neighbors, start, dir);
+        if (dir != banned_dir && next != NO_CELL &&
+            distance_to_food(df, next) < best) {
+            best = distance_to_food(df, next);
+            first = next;
+        }
+    }
+    if (first == NO_CELL) {
+        return 0;
+    }
+
+    // each cell on the way has a neighbor one step closer to the food
+    size_t steps = best + 1;
+    unsigned current = first;
+    ap->frontier[steps - 1] = current;
+    for (size_t i = steps - 1; i-- > 0;) {
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(ap->neighbors, current, dir);
+            if (next != NO_CELL &&
+                distance_to_food(df, next) + 1 ==
+                    distance_to_food(df, current)) {
+                current = next;
+                break;
+            }
+        }
+        ap->frontier[i] = current;
+    }
+    return steps;
+}
+
+/** Checks whether following the path in `ap->frontier` to the food is safe:
+ * after the snake has eaten there and grown by `growth` segments, its new
+ * tail must still be reachable from its new head. The snake's cells are in
+ * `ap->body`.
+ */
+static int path_is_safe(autopilot_t* ap, const int* cells, size_t steps,
+                        size_t length, size_t growth) {
+    unsigned food = ap->frontier[0];
+    size_t new_length = length + growth;
+    unsigned new_tail;
+
+    // a snake that is still only a head can always move on
+    if (new_length < 2) {
+        return 1;
+    }
+
+    // The virtual snake is the path (food first) followed by as much of the
+    // old body as still fits; everything past its tail has been released.
+    reset_overrides(ap);
+    size_t path_body = new_length > steps ? steps : new_length - 1;
+    for (size_t i = 1; i < path_body; i++) {
+        ap->blocked[ap->frontier[i]] = ap->blocked_epoch;
+    }
+    if (new_length > steps) {
+        // growing by more than the path is long leaves the tail in place
+        size_t kept = new_length - steps;
+        kept = kept < length ? kept : length;
+        new_tail = ap->body[kept - 1];
+        for (size_t i = 0; i + 1 < kept; i++) {
+            ap->blocked[ap->body[i]] = ap->blocked_epoch;
+        }
+        for (size_t i = kept; i < length; i++) {
+            ap->freed[ap->body[i]] = ap->blocked_epoch;
+        }
+    } else {
+        new_tail = ap->frontier[new_length - 1];
+        for (size_t i = 0; i < length; i++) {
+            ap->freed[ap->body[i]] = ap->blocked_epoch;
+        }
+    }
+
+    int safe = search(ap, cells, food, GOAL_CELL, new_tail, new_tail, -1) !=
+               NO_CELL;
+    reset_overrides(ap);
+    return safe;
+}
+
+/** Converts a step between adjacent cells into the matching input. */
+static enum input_key step_input(const autopilot_t* ap, unsigned from,
+                                 unsigned to) {
+    for (int dir = 0; dir < 4; dir++) {
+        if (neighbor_of(ap->neighbors, from, dir) == to) {
+            return (enum input_key)dir;
+        }
+    }
+    return INPUT_NONE;
+}
+
+/** Returns 1 if the head can move onto `cell`: it is plain, food, or the
+ * tail, which moves out of the way (NO_CELL if it stays put).
+ */
+static int is_open(const autopilot_t* ap, const int* cells, unsigned cell,
+                   unsigned tail) {
+    int flag = cell_flag_at(cells, ap->width, cell);
+    return flag == FLAG_PLAIN_CELL || flag == FLAG_FOOD || cell == tail;
+}
+
+/** Picks the next input for the snake.
+ *
+ * Plans a shortest path to the nearest food and takes it if, once the snake
+ * gets there, its tail is still reachable from the food without crossing the
+ * path — otherwise the snake could seal itself in. Failing that it chases its
+ * own tail, and as a last resort moves towards the largest open region.
+ * Arguments:
+ *  - ap: an autopilot initialized for a board of this size.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct.
+ */
+enum input_key autopilot_next_input(autopilot_t* ap, int* cells, size_t width,
+                                    size_t height, snake_t* snake_p) {
+    int* head_pos = get_first(snake_p->position);
+    unsigned head = width * head_pos[0] + head_pos[1];
+    size_t length = 0;
+    for (node_t* node = snake_p->position; node; node = node->next) {
+        int* position = node->data;
+        ap->body[length++] = width * position[0] + position[1];
+    }
+    unsigned tail = ap->body[length - 1];
+    // `update` leaves the tail where it is while the snake grows, so it is
+    // only out of the way of the next step if nothing is left to grow
+    unsigned free_tail = snake_p->growth_pending == 0 ? tail : NO_CELL;
+
+    // `update` turns a reversal into "keep going" once the score is non-zero,
+    // so the search must not plan one.
+    int banned_dir = -1;
+    if (g_score != 0) {
+        banned_dir = head_pos[2] ^ 1;
+    }
+
+    reset_overrides(ap);
+
+    size_t to_food = 0;
+    if (ap->distances) {
+        to_food = descend(ap, head, banned_dir);
+    } else {
+        unsigned food =
+            search(ap, cells, head, GOAL_FOOD, 0, free_tail, banned_dir);
+        to_food = food != NO_CELL ? trace_path(ap, head, food) : 0;
+    }
+    if (to_food > 0) {
+        unsigned step = ap->frontier[to_food - 1];
+        size_t growth = snake_p->growth_pending + g_rules.growth;
+        if (path_is_safe(ap, cells, to_food, length, growth)) {
+            return step_input(ap, head, step);
+        }
+    }
+
+    // Chase the tail the long way round, which gives the body room to unwind
+    // instead of circling the same loop forever.
+    enum input_key best = INPUT_NONE;
+    size_t best_steps = 0;
+    if (length > 1) {
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(ap->neighbors, head, dir);
+            if (dir == banned_dir || next == NO_CELL ||
+                !is_open(ap, cells, next, free_tail)) {
+                continue;
+            }
+            size_t steps = 1;
+            if (next != tail) {
+                unsigned found =
+                    search(ap, cells, next, GOAL_CELL, tail, tail, -1);
+                if (found == NO_CELL) {
+                    continue;
+                }
+                steps += trace_path(ap, next, found);
+            }
+            // a tail still growing is still there when the head gets to it
+            if (steps <= (size_t)snake_p->growth_pending) {
+                continue;
+            }
+            if (steps > best_steps) {
+                best_steps = steps;
+                best = (enum input_key)dir;
+            }
+        }
+        if (best_steps > 0) {
+            return best;
+        }
+    }
+
+    size_t best_reached = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = neighbor_of(ap->neighbors, head, dir);
+        if (dir == banned_dir || next == NO_CELL ||
+            !is_open(ap, cells, next, free_tail)) {
+            continue;
+        }
+        size_t reached;
+        if (ap->regions) {
+            reached = connectivity_reachable_from(ap->regions, cells, next,
+                                                  free_tail);
+        } else {
+            search(ap, cells, next, GOAL_NONE, 0, free_tail, -1);
+            reached = ap->reached;
+        }
+        if (reached > best_reached) {
+            best_reached = reached;
+            best = (enum input_key)dir;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,55 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <stddef.h>
+
+#include "common.h"
+#include "connectivity.h"
+#include "distance_field.h"
+
+/** Autopilot struct. Holds the search buffers so that planning a move never
+ * allocates; every buffer has one entry per board cell.
+ * Fields:
+ *  - width, height: dimensions of the board the buffers were sized for.
+ *  - seen: per-cell stamp; a cell was reached by the current search iff its
+ *    stamp equals `seen_epoch`.
+ *  - blocked: per-cell stamp; a cell is treated as an obstacle iff its stamp
+ *    equals `blocked_epoch`.
+ *  - freed: per-cell stamp; a snake cell is treated as free iff its stamp
+ *    equals `blocked_epoch`.
+ *  - parent: the cell each reached cell was discovered from.
+ *  - frontier: the BFS queue.
+ *  - body: scratch list of the snake's cells, head first.
+ *  - neighbors: the shared neighbor table of the board (see
+ *    neighbor_table.h), as of when the autopilot was initialized.
+ *  - reached: number of cells reached by the last search.
+ *  - regions: optional connectivity tracker kept in step with the board by
+ *    the caller; when set, open regions are sized from it instead of being
+ *    searched. NULL after `autopilot_init`.
+ *  - distances: optional distance field kept in step with the board by the
+ *    caller; when set, the way to food is read off it instead of searched
+ *    for. NULL after `autopilot_init`.
+ */
+typedef struct autopilot {
+    size_t width;
+    size_t height;
+    unsigned* seen;
+    unsigned* blocked;
+    unsigned* freed;
+    unsigned* parent;
+    unsigned* frontier;
+    unsigned* body;
+    const unsigned* neighbors;
+    unsigned seen_epoch;
+    unsigned blocked_epoch;
+    size_t reached;
+    connectivity_t* regions;
+    distance_field_t* distances;
+} autopilot_t;
+
+int autopilot_init(autopilot_t* ap, size_t width, size_t height);
+void autopilot_free(autopilot_t* ap);
+enum input_key autopilot_next_input(autopilot_t* ap, int* cells, size_t width,
+                                    size_t height, snake_t* snake_p);
+
+#endif
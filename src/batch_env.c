@@ -0,0 +1,252 @@
+#include "batch_env.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_layout.h"
+#include "linked_list.h"
+#include "rules.h"
+
+// How many random probes `batch_place_food` makes before falling back to a
+// scan of the board.
+#define FOOD_PROBES 64
+
+/** Returns the next value of a game's xorshift random state. */
+static unsigned next_random(unsigned* state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/** Sets a random plain cell of the given board to food, like `place_food`
+ * but drawing from the game's own random state so that games stay
+ * independent of each other and of the global seed.
+ */
+static void batch_place_food(unsigned char* board, size_t cells,
+                             unsigned* rng) {
+    for (int i = 0; i < FOOD_PROBES; i++) {
+        size_t index = next_random(rng) % cells;
+        if (board[index] == FLAG_PLAIN_CELL) {
+            board[index] = FLAG_FOOD;
+            return;
+        }
+    }
+
+    // Nearly full board: take the first plain cell after a random start.
+    size_t start = next_random(rng) % cells;
+    for (size_t i = 0; i < cells; i++) {
+        size_t index = (start + i) % cells;
+        if (board[index] == FLAG_PLAIN_CELL) {
+            board[index] = FLAG_FOOD;
+            return;
+        }
+    }
+}
+
+/** Puts game `g` back in its starting state. */
+static void reset_game(batch_env_t* env, size_t g) {
+    size_t cells = env->width * env->height;
+    unsigned char* board = env->boards + g * cells;
+
+    memcpy(board, env->initial, cells);
+    env->heads[g] = env->start_cell;
+    env->dirs[g] = env->start_dir;
+    env->scores[g] = 0;
+    env->lengths[g] = 1;
+    env->pending[g] = 0;
+    packed_body_reset(&env->bodies[g], env->start_cell);
+    batch_place_food(board, cells, &env->rng[g]);
+}
+
+/** Initializes a batch of games that all start from the given board, played
+ * with the growth and wrap of the current `g_rules`.
+ * Returns 0 on success and -1 if memory could not be allocated.
+ * Arguments:
+ *  - env: the environment to initialize.
+ *  - count: number of games to run.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell, e.g. as set up by `initialize_game`. Any
+ *    food on it is ignored; each game places its own.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct on that board.
+ *  - growing: 0 if the snakes do not grow on eating, 1 if they do.
+ *  - seed: seed for food placement; game `g` is seeded from `seed` and `g`.
+ *  - boards: caller-provided buffer of `count * width * height` bytes that
+ *    receives every game's board.
+ */
+int batch_env_init(batch_env_t* env, size_t count, int* cells, size_t width,
+                   size_t height, snake_t* snake_p, int growing,
+                   unsigned seed, unsigned char* boards) {
+    size_t board_cells = width * height;
+    int* head = get_first(snake_p->position);
+
+    env->count = count;
+    env->width = width;
+    env->height = height;
+    env->growing = growing;
+    env->growth = growing ? g_rules.growth : 0;
+    env->wrap = g_rules.wrap;
+    env->boards = boards;
+    env->start_cell = width * head[0] + head[1];
+    env->start_dir = head[2];
+
+    env->initial = malloc(board_cells);
+    env->heads = malloc(count * sizeof(unsigned));
+    env->dirs = malloc(count);
+    env->scores = malloc(count * sizeof(int));
+    env->done = calloc(count, 1);
+    env->lengths = malloc(count * sizeof(unsigned));
+    env->pending = malloc(count * sizeof(unsigned));
+    env->bodies = calloc(count, sizeof(packed_body_t));
+    env->rng = malloc(count * sizeof(unsigned));
+    if (!env->initial || !env->heads || !env->dirs || !env->scores ||
+        !env->done || !env->lengths || !env->pending || !env->bodies || !env->rng) {
+        batch_env_free(env);
+        return -1;
+    }
+    // a snake never has more links than the board has cells, so with the
+    // rings reserved up front stepping never allocates
+    for (size_t g = 0; g < count; g++) {
+        if (packed_body_init(&env->bodies[g], width, height,
+                             env->start_cell) != 0 ||
+            packed_body_reserve(&env->bodies[g], board_cells) != 0) {
+            batch_env_free(env);
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < board_cells; i++) {
+        int cell = cell_flag_at(cells, width, i);
+        env->initial[i] = cell == FLAG_FOOD ? FLAG_PLAIN_CELL : cell;
+    }
+
+    for (size_t g = 0; g < count; g++) {
+        // xorshift gets stuck at 0, so make sure no game starts there
+        env->rng[g] = (seed ^ (unsigned)(g * 2654435761u)) | 1;
+        reset_game(env, g);
+    }
+    return 0;
+}
+
+/** Frees the memory held by the environment (but not the caller's boards). */
+void batch_env_free(batch_env_t* env) {
+    free(env->initial);
+    free(env->heads);
+    free(env->dirs);
+    free(env->scores);
+    free(env->done);
+    free(env->lengths);
+    free(env->pending);
+    if (env->bodies) {
+        for (size_t g = 0; g < env->count; g++) {
+            packed_body_free(&env->bodies[g]);
+        }
+    }
+    free(env->bodies);
+    free(env->rng);
+    env->initial = NULL;
+    env->heads = NULL;
+    env->dirs = NULL;
+    env->scores = NULL;
+    env->done = NULL;
+    env->lengths = NULL;
+    env->pending = NULL;
+    env->bodies = NULL;
+    env->rng = NULL;
+}
+
+/** Advances every game by a single step, following the same rules as
+ * `update` with no item table: one food at a time and no power-ups, whatever
+ * `g_rules` says about those. Games that ended on the previous step are
+ * reset first, so the final board and `done` flag of a game stay visible for
+ * one step.
+ * Arguments:
+ *  - env: the environment.
+ *  - actions: one `enum input_key` value per game; values past INPUT_NONE
+ *    are treated as INPUT_NONE.
+ */
+void step_batch(batch_env_t* env, const unsigned char* actions) {
+    size_t width = env->width;
+    size_t cells = width * env->height;
+    int wrap = env->wrap;
+
+    for (size_t g = 0; g < env->count; g++) {
+        if (env->done[g]) {
+            reset_game(env, g);
+            env->done[g] = 0;
+        }
+
+        unsigned char* board = env->boards + g * cells;
+        packed_body_t* body = &env->bodies[g];
+        unsigned head = env->heads[g];
+        unsigned dir = env->dirs[g];
+        unsigned action = actions[g];
+
+        // actions may come from another process; anything that is not a
+        // move counts as INPUT_NONE, like `bot_plugin_decide_batch`
+        if (action < INPUT_NONE) {
+            // like `update`, reversing is ignored once the score is non-zero
+            dir = (env->scores[g] != 0 && action == (dir ^ 1)) ? dir : action;
+        }
+
+        size_t row = head / width;
+        size_t col = head % width;
+        // off the edge is `cells`, which counts as a wall, unless the board
+        // wraps
+        unsigned next;
+        switch (dir) {
+            case INPUT_UP:
+                next = row > 0 ? head - width : wrap ? head + cells - width
+                                                     : cells;
+                break;
+            case INPUT_DOWN:
+                next = head + width < cells ? head + width : wrap ? col : cells;
+                break;
+            case INPUT_LEFT:
+                next = col > 0 ? head - 1 : wrap ? head + width - 1 : cells;
+                break;
+            default:
+                next = col + 1 < width ? head + 1 : wrap ? head - col : cells;
+                break;
+        }
+
+        // the tail is only out of the way if it moves this step
+        unsigned tail = env->pending[g] == 0 ? body->tail : cells;
+
+        int target = next < cells ? board[next] : FLAG_WALL;
+        if (target == FLAG_WALL || (target == FLAG_SNAKE && next != tail)) {
+            env->done[g] = 1;
+            continue;
+        }
+
+        // the ring was reserved for a full board, so this cannot fail; it
+        // still goes before the score and food so that a failure changes
+        // nothing else
+        if (packed_body_push_head(body, dir) != 0) {
+            env->done[g] = 1;
+            continue;
+        }
+        int ate = target == FLAG_FOOD;
+        if (ate) {
+            env->scores[g]++;
+            batch_place_food(board, cells, &env->rng[g]);
+        }
+        if (ate) {
+            env->pending[g] += env->growth;
+        }
+        if (env->pending[g] > 0) {
+            env->pending[g]--;
+            env->lengths[g]++;
+        } else {
+            board[packed_body_pop_tail(body)] = FLAG_PLAIN_CELL;
+        }
+
+        board[next] = FLAG_SNAKE;
+        env->heads[g] = next;
+        env->dirs[g] = dir;
+    }
+}
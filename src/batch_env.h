@@ -0,0 +1,62 @@
+#ifndef BATCH_ENV_H
+#define BATCH_ENV_H
+
+#include <stddef.h>
+
+#include "common.h"
+#include "packed_body.h"
+
+/** Batched environment struct. Steps `count` independent games in lockstep,
+ * keeping each field as one array indexed by game (structure of arrays) so
+ * that a step streams through memory instead of chasing pointers.
+ * Fields:
+ *  - count: number of games.
+ *  - width, height: dimensions shared by every board.
+ *  - growing: 1 if snakes grow on eating, 0 otherwise.
+ *  - growth: segments a snake grows per food eaten: `g_rules.growth` when
+ *    `growing`, 0 otherwise.
+ *  - wrap: `g_rules.wrap`, 1 if snakes come back in on the opposite edge.
+ *  - boards: `count` boards of `width * height` cells each, stored back to
+ *    back as FLAG_* values. This is the caller's observation buffer; games are
+ *    stepped in place, so observations are never copied.
+ *  - initial: the starting board shared by every game, without food.
+ *  - start_cell, start_dir: starting head cell and direction of every game.
+ *  - heads: index of each snake's head cell within its board.
+ *  - dirs: direction each snake is heading (0 up, 1 down, 2 left, 3 right).
+ *  - scores: score of each game.
+ *  - done: 1 if the game ended on the last step, 0 otherwise.
+ *  - lengths: number of cells in each snake.
+ *  - pending: segments each snake has still to grow; its tail stays put
+ *    meanwhile.
+ *  - bodies: each snake's cells, packed at 2 bits per segment, with room
+ *    reserved for a snake filling the board.
+ *  - rng: per-game random state used to place food.
+ */
+typedef struct batch_env {
+    size_t count;
+    size_t width;
+    size_t height;
+    int growing;
+    unsigned growth;
+    int wrap;
+    unsigned char* boards;
+    unsigned char* initial;
+    unsigned start_cell;
+    unsigned char start_dir;
+    unsigned* heads;
+    unsigned char* dirs;
+    int* scores;
+    unsigned char* done;
+    unsigned* lengths;
+    unsigned* pending;
+    packed_body_t* bodies;
+    unsigned* rng;
+} batch_env_t;
+
+int batch_env_init(batch_env_t* env, size_t count, int* cells, size_t width,
+                   size_t height, snake_t* snake_p, int growing,
+                   unsigned seed, unsigned char* boards);
+void batch_env_free(batch_env_t* env);
+void step_batch(batch_env_t* env, const unsigned char* actions);
+
+#endif
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include "board_alloc.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Size of a huge page on x86-64 and most arm64 kernels.
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/** A mapped board allocated by `board_alloc`.
+ * Fields:
+ *  - board: the address handed out.
+ *  - length: length of the mapping.
+ *  - backing: how the mapping is backed.
+ */
+typedef struct board_block {
+    void* board;
+    size_t length;
+    enum board_backing backing;
+} board_block_t;
+
+unsigned g_board_threads = 1;
+
+// Every live mapped board, so `board_free` knows to unmap it. Heap boards
+// are not recorded: anything missing here goes to free. Mapped boards are
+// at least a huge page each, so there are few of them to search.
+static board_block_t* s_blocks;
+static size_t s_block_count;
+static size_t s_block_capacity;
+static pthread_mutex_t s_blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** One first-touch worker's share of a board.
+ * Fields:
+ *  - thread: the worker, if `started`.
+ *  - begin, length: the share.
+ *  - cpu: the CPU the worker pins itself to.
+ *  - started: 1 if the worker was created and has to be joined.
+ */
+typedef struct touch_job {
+    pthread_t thread;
+    unsigned char* begin;
+    size_t length;
+    unsigned cpu;
+    int started;
+} touch_job_t;
+
+/** Pins the calling thread to `job->cpu` and writes every page of its share,
+ * so the kernel backs the share with memory near that CPU.
+ */
+static void* touch_share(void* arg) {
+    touch_job_t* job = arg;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(job->cpu, &set);
+    // not being able to pin only costs locality
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    memset(job->begin, 0, job->length);
+    return NULL;
+}
+
+/** Returns the `n`th CPU in `set`, counting from 0. */
+static unsigned nth_cpu(const cpu_set_t* set, unsigned n) {
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, set) && n-- == 0) {
+            return cpu;
+        }
+    }
+    return 0;
+}
+
+/** Splits the first touch of a fresh mapping across `g_board_threads`
+ * threads, pinned in turn to the CPUs the process may run on. Empty shares
+ * get no thread; shares whose thread cannot be started are touched by the
+ * caller instead.
+ */
+static void first_touch(unsigned char* board, size_t bytes) {
+    unsigned threads = g_board_threads;
+    if (threads <= 1) {
+        return;
+    }
+    touch_job_t* jobs = calloc(threads, sizeof(touch_job_t));
+    if (!jobs) {
+        return;
+    }
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ||
+        CPU_COUNT(&allowed) == 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+    unsigned cpus = CPU_COUNT(&allowed);
+
+    for (unsigned i = 0; i < threads; i++) {
+        size_t begin, end;
+        board_partition(bytes, threads, i, &begin, &end);
+        jobs[i].begin = board + begin;
+        jobs[i].length = end - begin;
+        jobs[i].cpu = nth_cpu(&allowed, i % cpus);
+        // a board of fewer huge pages than threads leaves some shares empty
+        if (jobs[i].length == 0) {
+            continue;
+        }
+        jobs[i].started = pthread_create(&jobs[i].thread, NULL, touch_share,
+                                         &jobs[i]) == 0;
+        if (!jobs[i].started) {
+            memset(jobs[i].begin, 0, jobs[i].length);
+        }
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].thread, NULL);
+        }
+    }
+    free(jobs);
+}
+
+/** Maps `bytes` of huge-page-aligned memory, trying explicit huge pages
+ * first and then transparent ones. Stores the mapped length and backing in
+ * `length_p` and `backing_p`. Returns NULL if nothing could be mapped.
+ */
+static void* map_board(size_t bytes, size_t* length_p,
+                       enum board_backing* backing_p) {
+    size_t length = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    void* board = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (board != MAP_FAILED) {
+        *length_p = length;
+        *backing_p = BOARD_HUGETLB;
+        return board;
+    }
+
+    // no reserved huge pages: over-map by one huge page and trim both ends
+    // so the board starts on a huge page boundary
+    size_t padded = length + HUGE_PAGE_SIZE;
+    unsigned char* raw = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    uintptr_t address = (uintptr_t)raw;
+    unsigned char* aligned =
+        (unsigned char*)((address + HUGE_PAGE_SIZE - 1) &
+                         ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    size_t head = aligned - raw;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (padded - head > length) {
+        munmap(aligned + length, padded - head - length);
+    }
+
+    *length_p = length;
+    *backing_p = madvise(aligned, length, MADV_HUGEPAGE) == 0 ? BOARD_THP
+                                                                : BOARD_MMAP;
+    return aligned;
+}
+
+/** Records a live mapped board. Call with `s_blocks_lock` held. Returns 0
+ * on success and -1 if memory could not be allocated.
+ */
+static int remember(void* board, size_t length, enum board_backing backing) {
+    if (s_block_count == s_block_capacity) {
+        size_t capacity = s_block_capacity ? s_block_capacity * 2 : 8;
+        board_block_t* grown =
+            realloc(s_blocks, capacity * sizeof(board_block_t));
+        if (!grown) {
+            return -1;
+        }
+        s_blocks = grown;
+        s_block_capacity = capacity;
+    }
+    s_blocks[s_block_count++] = (board_block_t){
+        .board = board,
+        .length = length,
+        .backing = backing,
+    };
+    return 0;
+}
+
+/** Returns the registry slot of `board`, or `s_block_count` if it is not
+ * there. Call with `s_blocks_lock` held.
+ */
+static size_t find(const void* board) {
+    size_t i = 0;
+    while (i < s_block_count && s_blocks[i].board != board) {
+        i++;
+    }
+    return i;
+}
+
+/** Allocates memory for a board of `bytes` bytes, zero-filled if `zeroed`
+ * is 1. Returns NULL if memory could not be allocated.
+ */
+static void* allocate(size_t bytes, int zeroed) {
+    void* board = NULL;
+    size_t length = 0;
+    enum board_backing backing = BOARD_MALLOC;
+
+    if (bytes >= HUGE_PAGE_SIZE) {
+        board = map_board(bytes, &length, &backing);
+    }
+    if (!board) {
+        return zeroed ? calloc(1, bytes) : malloc(bytes);
+    }
+
+    pthread_mutex_lock(&s_blocks_lock);
+    int status = remember(board, length, backing);
+    pthread_mutex_unlock(&s_blocks_lock);
+    if (status != 0) {
+        munmap(board, length);
+        return NULL;
+    }
+    first_touch(board, bytes);
+    return board;
+}
+
+/** Allocates memory for a board of `bytes` bytes. Boards of at least a huge
+ * page are mapped on huge pages where the system allows it and first-touched
+ * by `g_board_threads` pinned threads; smaller ones come from malloc. The
+ * contents are unspecified. Returns NULL if memory could not be allocated.
+ * Release the board with `board_free`.
+ */
+void* board_alloc(size_t bytes) {
+    return allocate(bytes, 0);
+}
+
+/** Like `board_alloc`, but the board starts zero-filled. Mapped boards are
+ * zero-filled by the kernel as each page is first touched, so pages nobody
+ * writes cost nothing (unless `g_board_threads` asks for a first touch).
+ */
+void* board_alloc_zeroed(size_t bytes) {
+    return allocate(bytes, 1);
+}
+
+/** Frees a board from `board_alloc`. Boards the registry does not know,
+ * including NULL, are passed to free.
+ */
+void board_free(void* board) {
+    size_t length = 0;
+    pthread_mutex_lock(&s_blocks_lock);
+    size_t i = find(board);
+    if (i < s_block_count) {
+        length = s_blocks[i].length;
+        s_blocks[i] = s_blocks[--s_block_count];
+        if (s_block_count == 0) {
+            free(s_blocks);
+            s_blocks = NULL;
+            s_block_capacity = 0;
+        }
+    }
+    pthread_mutex_unlock(&s_blocks_lock);
+
+    if (length > 0) {
+        munmap(board, length);
+    } else {
+        free(board);
+    }
+}
+
+/** Returns the `enum board_backing` of a board from `board_alloc`. Boards
+ * that were not mapped there count as BOARD_MALLOC.
+ */
+int board_backing(const void* board) {
+    pthread_mutex_lock(&s_blocks_lock);
+    size_t i = find(board);
+    int backing = i < s_block_count ? (int)s_blocks[i].backing : BOARD_MALLOC;
+    pthread_mutex_unlock(&s_blocks_lock);
+    return backing;
+}
+
+/** Finds part `part` of `parts` roughly equal parts of a `bytes`-byte board,
+ * split on huge page boundaries so that no page is shared between parts.
+ * Stores the byte range [begin, end) in `begin_p` and `end_p`; trailing
+ * parts of a small board may be empty.
+ */
+void board_partition(size_t bytes, unsigned parts, unsigned part,
+                     size_t* begin_p, size_t* end_p) {
+    size_t pages = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+    size_t begin = pages * part / parts * HUGE_PAGE_SIZE;
+    size_t end = pages * (part + 1) / parts * HUGE_PAGE_SIZE;
+    *begin_p = begin < bytes ? begin : bytes;
+    *end_p = end < bytes ? end : bytes;
+}
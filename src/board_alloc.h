@@ -0,0 +1,30 @@
+#ifndef BOARD_ALLOC_H
+#define BOARD_ALLOC_H
+
+#include <stddef.h>
+
+/** Where a board's memory came from.
+ *  - BOARD_MALLOC: the heap; used for boards smaller than a huge page.
+ *  - BOARD_HUGETLB: explicit huge pages (MAP_HUGETLB).
+ *  - BOARD_THP: an anonymous mapping aligned to huge pages and advised
+ *    MADV_HUGEPAGE, so transparent huge pages can back it.
+ *  - BOARD_MMAP: an anonymous mapping of normal pages.
+ */
+enum board_backing { BOARD_MALLOC, BOARD_HUGETLB, BOARD_THP, BOARD_MMAP };
+
+// Number of threads that first-touch a newly mapped board. Part `i` of the
+// board (see `board_partition`) is touched by a thread pinned to the `i`th
+// CPU the process may run on (wrapping around), so under a first-touch NUMA
+// policy it lands on that CPU's node. Workers stepping part `i` should run
+// there too. 1 touches nothing up front, leaving each page to whoever
+// writes it first. Set by `--board-threads` in snake and snake-server.
+extern unsigned g_board_threads;
+
+void* board_alloc(size_t bytes);
+void* board_alloc_zeroed(size_t bytes);
+void board_free(void* board);
+int board_backing(const void* board);
+void board_partition(size_t bytes, unsigned parts, unsigned part,
+                     size_t* begin_p, size_t* end_p);
+
+#endif
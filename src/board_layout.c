@@ -0,0 +1,99 @@
+#include "board_layout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Tile sides, as powers of two, of the tiled and Morton layouts.
+#define TILED_BITS 3
+#define MORTON_BITS 6
+
+board_layout_t g_layout;
+
+/** Parses a layout name: "row", "tiled" or "morton". Returns 0 on success
+ * and -1 if the name is not one of these.
+ */
+int layout_parse(const char* name, enum layout_kind* kind_p) {
+    if (strcmp(name, "row") == 0) {
+        *kind_p = LAYOUT_ROW_MAJOR;
+    } else if (strcmp(name, "tiled") == 0) {
+        *kind_p = LAYOUT_TILED;
+    } else if (strcmp(name, "morton") == 0) {
+        *kind_p = LAYOUT_MORTON;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/** Spreads the low bits of `x` out to the even bit positions. */
+static size_t spread_bits(size_t x) {
+    size_t out = 0;
+    for (int bit = 0; x >> bit; bit++) {
+        out |= ((x >> bit) & 1) << (2 * bit);
+    }
+    return out;
+}
+
+/** Sets up `layout` for a board of the given size, using `layout->kind`.
+ * Returns the number of cells to allocate for the board. If the tables
+ * cannot be allocated the board falls back to row-major.
+ * Arguments:
+ *  - layout: the layout; its `kind` says which layout to build.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+size_t layout_init(board_layout_t* layout, size_t width, size_t height) {
+    free(layout->row_offset);
+    free(layout->col_offset);
+    layout->row_offset = NULL;
+    layout->col_offset = NULL;
+    layout->width = width;
+    layout->height = height;
+    layout->storage = width * height;
+
+    if (layout->kind == LAYOUT_ROW_MAJOR || width == 0 || height == 0) {
+        return layout->storage;
+    }
+
+    size_t* row_offset = malloc(height * sizeof(size_t));
+    size_t* col_offset = malloc(width * sizeof(size_t));
+    if (!row_offset || !col_offset) {
+        free(row_offset);
+        free(col_offset);
+        return layout->storage;
+    }
+
+    int bits = layout->kind == LAYOUT_TILED ? TILED_BITS : MORTON_BITS;
+    size_t side = (size_t)1 << bits;
+    size_t mask = side - 1;
+    size_t tile_cells = side * side;
+    size_t tiles_per_row = (width + mask) >> bits;
+    size_t tile_rows = (height + mask) >> bits;
+
+    for (size_t row = 0; row < height; row++) {
+        size_t inner = layout->kind == LAYOUT_TILED
+                           ? (row & mask) << bits
+                           : spread_bits(row & mask) << 1;
+        row_offset[row] = (row >> bits) * tiles_per_row * tile_cells + inner;
+    }
+    for (size_t col = 0; col < width; col++) {
+        size_t inner = layout->kind == LAYOUT_TILED ? col & mask
+                                                    : spread_bits(col & mask);
+        col_offset[col] = (col >> bits) * tile_cells + inner;
+    }
+
+    layout->row_offset = row_offset;
+    layout->col_offset = col_offset;
+    layout->storage = tile_rows * tiles_per_row * tile_cells;
+    return layout->storage;
+}
+
+/** Frees the layout's tables; later boards are row-major until the next
+ * `layout_init`.
+ */
+void layout_free(board_layout_t* layout) {
+    free(layout->row_offset);
+    free(layout->col_offset);
+    layout->row_offset = NULL;
+    layout->col_offset = NULL;
+}
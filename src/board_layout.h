@@ -0,0 +1,96 @@
+#ifndef BOARD_LAYOUT_H
+#define BOARD_LAYOUT_H
+
+#include <stddef.h>
+
+#include "common.h"
+
+/** How board cells are arranged in memory.
+ *  - LAYOUT_ROW_MAJOR: `width * row + col`, one row after another.
+ *  - LAYOUT_TILED: 8x8 tiles, row-major within each tile and from tile to
+ *    tile, so that vertical neighbors are usually in the same cache lines.
+ *  - LAYOUT_MORTON: 64x64 tiles in Z-order (bits of row and column
+ *    interleaved) within each tile, tiles row-major.
+ */
+enum layout_kind { LAYOUT_ROW_MAJOR, LAYOUT_TILED, LAYOUT_MORTON };
+
+/** Board layout struct. Every layout splits into a per-row and a per-column
+ * part, so a cell's position in memory is the sum of two table entries.
+ * Fields:
+ *  - kind: the layout the next board is set up with.
+ *  - lazy: 1 if new boards start zero-filled, with cells left at
+ *    FLAG_UNSET until something is written there, 0 if every cell is
+ *    written up front.
+ *  - width, height: dimensions of the current board.
+ *  - storage: number of cells to allocate, including tile padding.
+ *  - row_offset: offset of each row's part; NULL while row-major.
+ *  - col_offset: offset of each column's part; NULL while row-major.
+ */
+typedef struct board_layout {
+    enum layout_kind kind;
+    int lazy;
+    size_t width;
+    size_t height;
+    size_t storage;
+    size_t* row_offset;
+    size_t* col_offset;
+} board_layout_t;
+
+// Layout of the board in play. Set `g_layout.kind` before the board is set
+// up; one layout is in use per process.
+extern board_layout_t g_layout;
+
+int layout_parse(const char* name, enum layout_kind* kind_p);
+size_t layout_init(board_layout_t* layout, size_t width, size_t height);
+void layout_free(board_layout_t* layout);
+
+// Value of a cell of a lazy board that has never been written. It reads as
+// FLAG_WALL on the edge of the board and FLAG_PLAIN_CELL elsewhere.
+#define FLAG_UNSET 0
+
+/** Returns where in `cells` the cell at (`row`, `col`) is stored. */
+static inline size_t cell_index(size_t width, size_t row, size_t col) {
+    if (!g_layout.row_offset) {
+        return width * row + col;
+    }
+    return g_layout.row_offset[row] + g_layout.col_offset[col];
+}
+
+/** Returns where in `cells` the cell with row-major index `index` (that is,
+ * `width * row + col`) is stored.
+ */
+static inline size_t cell_offset(size_t width, size_t index) {
+    if (!g_layout.row_offset) {
+        return index;
+    }
+    return g_layout.row_offset[index / width] +
+           g_layout.col_offset[index % width];
+}
+
+/** Returns what an unset cell at (`row`, `col`) of the current board reads
+ * as: a wall on the edge and plain everywhere else.
+ */
+static inline int implicit_flag(size_t row, size_t col) {
+    return row == 0 || col == 0 || row + 1 == g_layout.height ||
+                   col + 1 == g_layout.width
+               ? FLAG_WALL
+               : FLAG_PLAIN_CELL;
+}
+
+/** Returns the FLAG_* value of the cell at (`row`, `col`). Always read cells
+ * through this (or `cell_flag_at`), since lazy boards store FLAG_UNSET.
+ */
+static inline int cell_flag(const int* cells, size_t width, size_t row,
+                            size_t col) {
+    int flag = cells[cell_index(width, row, col)];
+    return flag != FLAG_UNSET ? flag : implicit_flag(row, col);
+}
+
+/** Returns the FLAG_* value of the cell with row-major index `index`. */
+static inline int cell_flag_at(const int* cells, size_t width, size_t index) {
+    int flag = cells[cell_offset(width, index)];
+    return flag != FLAG_UNSET ? flag
+                              : implicit_flag(index / width, index % width);
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "bot_plugin.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include "board_layout.h"
+#include "linked_list.h"
+
+// the ABI promises the engine's own values, so views need no translation
+_Static_assert(SNAKE_BOT_PLAIN == FLAG_PLAIN_CELL &&
+                   SNAKE_BOT_SNAKE == FLAG_SNAKE &&
+                   SNAKE_BOT_WALL == FLAG_WALL && SNAKE_BOT_FOOD == FLAG_FOOD,
+               "bot cell values must match the FLAG_* values");
+_Static_assert(SNAKE_BOT_UP == INPUT_UP && SNAKE_BOT_DOWN == INPUT_DOWN &&
+                   SNAKE_BOT_LEFT == INPUT_LEFT &&
+                   SNAKE_BOT_RIGHT == INPUT_RIGHT &&
+                   SNAKE_BOT_NONE == INPUT_NONE,
+               "bot moves must match enum input_key");
+
+static char s_error[256];
+
+/** Returns a description of the last `bot_plugin_load` failure. */
+const char* bot_plugin_error(void) {
+    return s_error;
+}
+
+/** Loads the bot in the shared object at `path` and sets it up for boards
+ * of the given size. Returns 0 on success and -1 on failure (see
+ * `bot_plugin_error`): the object could not be loaded, exports no
+ * SNAKE_BOT_ENTRY, was built for another ABI version or its `create`
+ * failed.
+ * Arguments:
+ *  - plugin: the plugin to load into.
+ *  - path: path of the shared object; without a slash, the dynamic
+ *    linker's search path is used.
+ *  - width: width of the boards the bot will play.
+ *  - height: height of the boards the bot will play.
+ */
+int bot_plugin_load(bot_plugin_t* plugin, const char* path, size_t width,
+                    size_t height) {
+    plugin->handle = NULL;
+    plugin->bot = NULL;
+    plugin->state = NULL;
+
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        snprintf(s_error, sizeof(s_error), "%s", dlerror());
+        return -1;
+    }
+    snake_bot_entry_fn entry;
+    // the C standard has no conversion from void* to a function pointer
+    *(void**)&entry = dlsym(handle, SNAKE_BOT_ENTRY);
+    const snake_bot_t* bot = entry ? entry() : NULL;
+    if (!bot) {
+        snprintf(s_error, sizeof(s_error), "%s: no bot found", path);
+        dlclose(handle);
+        return -1;
+    }
+    // only `abi_version` is laid out the same in every version, so nothing
+    // else is read until it matches
+    if (bot->abi_version != SNAKE_BOT_ABI_VERSION) {
+        snprintf(s_error, sizeof(s_error),
+                 "%s: built for bot ABI %u, expected %u", path,
+                 bot->abi_version, SNAKE_BOT_ABI_VERSION);
+        dlclose(handle);
+        return -1;
+    }
+    if (!bot->decide) {
+        snprintf(s_error, sizeof(s_error), "%s: no bot found", path);
+        dlclose(handle);
+        return -1;
+    }
+    void* state = NULL;
+    if (bot->create) {
+        state = bot->create(width, height);
+        if (!state) {
+            snprintf(s_error, sizeof(s_error), "%s: could not set up %s",
+                     path, bot->name ? bot->name : "the bot");
+            dlclose(handle);
+            return -1;
+        }
+    }
+
+    plugin->handle = handle;
+    plugin->bot = bot;
+    plugin->state = state;
+    return 0;
+}
+
+/** Frees the bot's state and unloads its shared object. */
+void bot_plugin_unload(bot_plugin_t* plugin) {
+    if (!plugin->handle) {
+        return;
+    }
+    if (plugin->bot->destroy) {
+        plugin->bot->destroy(plugin->state);
+    }
+    dlclose(plugin->handle);
+    plugin->handle = NULL;
+    plugin->bot = NULL;
+    plugin->state = NULL;
+}
+
+static int game_cell(const snake_bot_view_t* view, size_t row, size_t col) {
+    return cell_flag(view->board, view->width, row, col);
+}
+
+static size_t game_segments(const snake_bot_view_t* view, size_t* out,
+                            size_t max) {
+    const snake_t* snake = view->body;
+    size_t count = 0;
+    for (node_t* node = snake->position; node && count < max;
+         node = node->next) {
+        int* position = node->data;
+        out[count++] = view->width * position[0] + position[1];
+    }
+    return count;
+}
+
+/** Fills in a view of a game played with `update`.
+ * Arguments:
+ *  - view: the view to fill in.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct.
+ */
+void bot_view_game(snake_bot_view_t* view, const int* cells, size_t width,
+                   size_t height, snake_t* snake_p) {
+    int* head = get_first(snake_p->position);
+    view->width = width;
+    view->height = height;
+    view->head_row = head[0];
+    view->head_col = head[1];
+    view->head_dir = head[2];
+    view->length = snake_p->snake_len;
+    view->score = g_score;
+    view->board = cells;
+    view->body = snake_p;
+    view->cell = game_cell;
+    view->segments = game_segments;
+}
+
+static int batch_cell(const snake_bot_view_t* view, size_t row, size_t col) {
+    const unsigned char* board = view->board;
+    return board[view->width * row + col];
+}
+
+static size_t batch_segments(const snake_bot_view_t* view, size_t* out,
+                             size_t max) {
+    packed_body_iter_t it;
+    packed_body_iter_begin(view->body, &it);
+    size_t count = 0;
+    unsigned cell;
+    while (count < max && packed_body_iter_next(&it, &cell)) {
+        out[count++] = cell;
+    }
+    return count;
+}
+
+/** Fills in one view per game of a batched environment, `env->count` in
+ * all, in the order `step_batch` takes their moves.
+ */
+void bot_view_batch(snake_bot_view_t* views, const batch_env_t* env) {
+    size_t cells = env->width * env->height;
+    for (size_t g = 0; g < env->count; g++) {
+        snake_bot_view_t* view = &views[g];
+        view->width = env->width;
+        view->height = env->height;
+        view->head_row = env->heads[g] / env->width;
+        view->head_col = env->heads[g] % env->width;
+        view->head_dir = env->dirs[g];
+        view->length = env->lengths[g];
+        view->score = env->scores[g];
+        view->board = env->boards + g * cells;
+        view->body = &env->bodies[g];
+        view->cell = batch_cell;
+        view->segments = batch_segments;
+    }
+}
+
+/** Returns the bot's move for the game in `view`; anything that is not a
+ * move counts as INPUT_NONE.
+ */
+enum input_key bot_plugin_decide(bot_plugin_t* plugin,
+                                 const snake_bot_view_t* view) {
+    int move = plugin->bot->decide(plugin->state, view);
+    return move >= INPUT_UP && move <= INPUT_NONE ? (enum input_key)move
+                                                  : INPUT_NONE;
+}
+
+/** Writes the bot's move for each of `count` games to `moves`, ready for
+ * `step_batch`. Uses the bot's `decide_batch` if it has one.
+ */
+void bot_plugin_decide_batch(bot_plugin_t* plugin,
+                             const snake_bot_view_t* views, size_t count,
+                             unsigned char* moves) {
+    if (!plugin->bot->decide_batch) {
+        for (size_t g = 0; g < count; g++) {
+            moves[g] = bot_plugin_decide(plugin, &views[g]);
+        }
+        return;
+    }
+    plugin->bot->decide_batch(plugin->state, views, count, moves);
+    for (size_t g = 0; g < count; g++) {
+        if (moves[g] > INPUT_NONE) {
+            moves[g] = INPUT_NONE;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef BOT_PLUGIN_H
+#define BOT_PLUGIN_H
+
+#include <stddef.h>
+
+#include "batch_env.h"
+#include "common.h"
+#include "snake_bot.h"
+
+/** Bot plugin struct. A bot loaded from a shared object (see snake_bot.h).
+ * Fields:
+ *  - handle: the dlopen(3) handle of the shared object.
+ *  - bot: the bot's entry table.
+ *  - state: what the bot's `create` returned.
+ */
+typedef struct bot_plugin {
+    void* handle;
+    const snake_bot_t* bot;
+    void* state;
+} bot_plugin_t;
+
+int bot_plugin_load(bot_plugin_t* plugin, const char* path, size_t width,
+                    size_t height);
+void bot_plugin_unload(bot_plugin_t* plugin);
+const char* bot_plugin_error(void);
+void bot_view_game(snake_bot_view_t* view, const int* cells, size_t width,
+                   size_t height, snake_t* snake_p);
+void bot_view_batch(snake_bot_view_t* views, const batch_env_t* env);
+enum input_key bot_plugin_decide(bot_plugin_t* plugin,
+                                 const snake_bot_view_t* view);
+void bot_plugin_decide_batch(bot_plugin_t* plugin,
+                             const snake_bot_view_t* views, size_t count,
+                             unsigned char* moves);
+
+#endif
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include "broadcast.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "board_layout.h"
+
+// Bytes per delta entry: a uint32_t index and a one-byte flag.
+#define DELTA_ENTRY_SIZE 5
+// Bytes in a keyframe before the cells: header, width and height.
+#define KEYFRAME_PREFIX (sizeof(broadcast_header_t) + 2 * sizeof(uint32_t))
+
+/** Opens the spectator socket at `path`. Delta frames are built from the
+ * cells `update` writes to `log`. Returns 0 on success and -1 on error (with
+ * errno set).
+ * Arguments:
+ *  - bc: the broadcast to open.
+ *  - path: filesystem path for the Unix domain socket; an old socket at that
+ *    path is replaced.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - keyframe_interval: number of ticks between keyframes.
+ *  - log: the cell log, which the caller has claimed with `cell_log_claim`
+ *    and keeps until the broadcast is closed.
+ */
+int broadcast_open(broadcast_t* bc, const char* path, size_t width,
+                   size_t height, unsigned keyframe_interval,
+                   const cell_log_t* log) {
+    struct sockaddr_un addr;
+
+    memset(bc, 0, sizeof(*bc));
+    bc->listen_fd = -1;
+    bc->width = width;
+    bc->height = height;
+    bc->keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+    bc->keyframe_size = KEYFRAME_PREFIX + width * height;
+    bc->log = log;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    bc->path = strdup(path);
+    bc->keyframe = malloc(bc->keyframe_size);
+    if (!bc->path || !bc->keyframe) {
+        broadcast_close(bc);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    bc->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (bc->listen_fd < 0) {
+        broadcast_close(bc);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(bc->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(bc->listen_fd, SOMAXCONN) != 0) {
+        broadcast_close(bc);
+        return -1;
+    }
+    return 0;
+}
+
+/** Stops broadcasting: disconnects every subscriber and removes the socket. */
+void broadcast_close(broadcast_t* bc) {
+    for (size_t i = 0; i < bc->sub_count; i++) {
+        close(bc->subs[i].fd);
+        free(bc->subs[i].pending);
+    }
+    if (bc->listen_fd >= 0) {
+        close(bc->listen_fd);
+        unlink(bc->path);
+    }
+    free(bc->subs);
+    free(bc->keyframe);
+    free(bc->delta);
+    free(bc->path);
+    memset(bc, 0, sizeof(*bc));
+    bc->listen_fd = -1;
+}
+
+/** Accepts every waiting spectator. New subscribers start with a keyframe. */
+static void accept_subscribers(broadcast_t* bc) {
+    for (;;) {
+        int fd = accept4(bc->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0) {
+            return;
+        }
+
+        if (bc->sub_count == bc->sub_capacity) {
+            size_t capacity = bc->sub_capacity ? bc->sub_capacity * 2 : 4;
+            subscriber_t* subs =
+                realloc(bc->subs, capacity * sizeof(subscriber_t));
+            if (!subs) {
+                close(fd);
+                return;
+            }
+            bc->subs = subs;
+            bc->sub_capacity = capacity;
+        }
+
+        // no frame is ever larger than a keyframe
+        char* pending = malloc(bc->keyframe_size);
+        if (!pending) {
+            close(fd);
+            return;
+        }
+        subscriber_t* sub = &bc->subs[bc->sub_count++];
+        sub->fd = fd;
+        sub->pending = pending;
+        sub->pending_len = 0;
+        sub->needs_keyframe = 1;
+    }
+}
+
+/** Sends as much of `bytes` as the socket takes without blocking. Returns the
+ * number of bytes sent, or -1 if the subscriber has gone away.
+ */
+static ssize_t send_some(int fd, const char* bytes, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, bytes + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+/** Writes a frame header into `out`. */
+static void put_header(char* out, uint8_t type, uint32_t tick,
+                       uint32_t count) {
+    broadcast_header_t header = {
+        .type = type,
+        .game_over = (uint8_t)g_game_over,
+        .tick = tick,
+        .score = g_score,
+        .count = count,
+    };
+    memcpy(out, &header, sizeof(header));
+}
+
+/** Builds a keyframe of the whole board into `bc->keyframe`. */
+static void build_keyframe(broadcast_t* bc, const int* cells) {
+    size_t count = bc->width * bc->height;
+    uint32_t dims[2] = {(uint32_t)bc->width, (uint32_t)bc->height};
+    char* out = bc->keyframe;
+
+    put_header(out, BROADCAST_KEYFRAME, bc->tick, count);
+    memcpy(out + sizeof(broadcast_header_t), dims, sizeof(dims));
+    out += KEYFRAME_PREFIX;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (char)cell_flag_at(cells, bc->width, i);
+    }
+}
+
+/** Builds a delta frame of the logged cells into `bc->delta`. Returns its
+ * size, or 0 if a keyframe has to be sent instead.
+ */
+static size_t build_delta(broadcast_t* bc, const int* cells) {
+    size_t count = bc->log->count;
+    size_t size = sizeof(broadcast_header_t) + count * DELTA_ENTRY_SIZE;
+
+    if (bc->log->overflow || size > bc->keyframe_size) {
+        return 0;
+    }
+    if (size > bc->delta_capacity) {
+        char* delta = realloc(bc->delta, size);
+        if (!delta) {
+            return 0;
+        }
+        bc->delta = delta;
+        bc->delta_capacity = size;
+    }
+
+    char* out = bc->delta;
+    put_header(out, BROADCAST_DELTA, bc->tick, count);
+    out += sizeof(broadcast_header_t);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = (uint32_t)bc->log->indices[i];
+        memcpy(out, &index, sizeof(index));
+        out[sizeof(index)] = (char)cell_flag_at(cells, bc->width, index);
+        out += DELTA_ENTRY_SIZE;
+    }
+    return size;
+}
+
+/** Publishes the current tick to every subscriber. Call once after each
+ * `update`. Never blocks: a subscriber that has not taken its previous frame
+ * yet skips this one and is resynchronized with a keyframe once it catches
+ * up.
+ * Arguments:
+ *  - bc: an open broadcast.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ */
+void broadcast_tick(broadcast_t* bc, const int* cells) {
+    accept_subscribers(bc);
+    if (bc->sub_count == 0) {
+        bc->tick++;
+        return;
+    }
+
+    size_t delta_size = 0;
+    int periodic = bc->tick % bc->keyframe_interval == 0;
+    int keyframe_built = 0;
+    if (!periodic) {
+        delta_size = build_delta(bc, cells);
+    }
+
+    size_t i = 0;
+    while (i < bc->sub_count) {
+        subscriber_t* sub = &bc->subs[i];
+        ssize_t sent = 0;
+
+        if (sub->pending_len > 0) {
+            sent = send_some(sub->fd, sub->pending, sub->pending_len);
+            if (sent >= 0) {
+                memmove(sub->pending, sub->pending + sent,
+                        sub->pending_len - sent);
+                sub->pending_len -= sent;
+                if (sub->pending_len > 0) {
+                    sub->needs_keyframe = 1;
+                    i++;
+                    continue;
+                }
+            }
+        }
+
+        if (sent >= 0) {
+            const char* frame = bc->delta;
+            size_t size = delta_size;
+            if (sub->needs_keyframe || delta_size == 0) {
+                if (!keyframe_built) {
+                    build_keyframe(bc, cells);
+                    keyframe_built = 1;
+                }
+                frame = bc->keyframe;
+                size = bc->keyframe_size;
+            }
+            sent = send_some(sub->fd, frame, size);
+            if (sent >= 0) {
+                sub->needs_keyframe = 0;
+                sub->pending_len = size - sent;
+                memcpy(sub->pending, frame + sent, sub->pending_len);
+            }
+        }
+
+        if (sent < 0) {
+            // gone: drop the subscriber by moving the last one into its slot
+            close(sub->fd);
+            free(sub->pending);
+            *sub = bc->subs[--bc->sub_count];
+            continue;
+        }
+        i++;
+    }
+
+    bc->tick++;
+}
@@ -0,0 +1,83 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// Frame types sent to subscribers.
+#define BROADCAST_KEYFRAME 'K'
+#define BROADCAST_DELTA 'D'
+
+/** Header that starts every frame sent to subscribers, in host byte order.
+ * A keyframe is followed by the board width and height (as uint32_t) and then
+ * one byte per cell holding its FLAG_* value, row by row. A delta frame is
+ * followed by `count` entries of a uint32_t cell index (`width * row + col`)
+ * and a one-byte FLAG_* value, packed without padding.
+ */
+typedef struct broadcast_header {
+    uint8_t type;
+    uint8_t game_over;
+    uint16_t reserved;
+    uint32_t tick;
+    int32_t score;
+    uint32_t count;
+} broadcast_header_t;
+
+/** Subscriber struct. One connected spectator.
+ * Fields:
+ *  - fd: the connection.
+ *  - pending: the unsent remainder of the last frame; never more than one
+ *    frame, since a subscriber that is still behind skips frames.
+ *  - pending_len: number of bytes in `pending`.
+ *  - needs_keyframe: 1 if the subscriber skipped a frame (or just joined) and
+ *    must be sent a keyframe next.
+ */
+typedef struct subscriber {
+    int fd;
+    char* pending;
+    size_t pending_len;
+    int needs_keyframe;
+} subscriber_t;
+
+/** Broadcast struct. Publishes the board to spectators over a Unix domain
+ * socket: a keyframe every `keyframe_interval` ticks and delta frames, built
+ * from the cells logged by `update`, in between.
+ * Fields:
+ *  - listen_fd: the listening socket.
+ *  - path: filesystem path of the socket.
+ *  - subs: connected subscribers.
+ *  - sub_count, sub_capacity: number of subscribers and room in `subs`.
+ *  - keyframe, delta: scratch buffers the frames are built in.
+ *  - keyframe_size: size of a keyframe for this board.
+ *  - delta_capacity: size of `delta`.
+ *  - log: the claimed cell log (see `cell_log_claim`), owned by the caller.
+ *  - width, height: dimensions of the board.
+ *  - tick: number of ticks published so far.
+ *  - keyframe_interval: ticks between periodic keyframes.
+ */
+typedef struct broadcast {
+    int listen_fd;
+    char* path;
+    subscriber_t* subs;
+    size_t sub_count;
+    size_t sub_capacity;
+    char* keyframe;
+    char* delta;
+    size_t keyframe_size;
+    size_t delta_capacity;
+    const cell_log_t* log;
+    size_t width;
+    size_t height;
+    uint32_t tick;
+    unsigned keyframe_interval;
+} broadcast_t;
+
+int broadcast_open(broadcast_t* bc, const char* path, size_t width,
+                   size_t height, unsigned keyframe_interval,
+                   const cell_log_t* log);
+void broadcast_tick(broadcast_t* bc, const int* cells);
+void broadcast_close(broadcast_t* bc);
+
+#endif
@@ -7,6 +7,26 @@ int g_game_over;
 int g_score;
 char* g_name;
 int g_name_len;
+cell_log_t* g_cell_log;
+
+/** Makes `log` the cell log `update` fills in. Returns 0 on success, or -1
+ * if a different log has already been claimed: a second log would leave
+ * the first one's readers following a log nobody writes.
+ */
+int cell_log_claim(cell_log_t* log) {
+    if (g_cell_log && g_cell_log != log) {
+        return -1;
+    }
+    g_cell_log = log;
+    return 0;
+}
+
+/** Stops `update` logging into `log`, if it was the claimed log. */
+void cell_log_release(cell_log_t* log) {
+    if (g_cell_log == log) {
+        g_cell_log = NULL;
+    }
+}
 
 /** Sets the seed for random number generation.
  * Arguments:
@@ -41,13 +41,43 @@ extern int g_name_len;
 
 /** Snake struct. This struct is not needed until part 2!
  * Fields:
- *  - None yet!
+ *  - position: the snake's segments, head first; each holds {row, col,
+ *    direction of its next move}.
+ *  - snake_len: number of segments.
+ *  - growth_pending: segments still to be added; the tail stays put for
+ *    that many ticks.
  */
 typedef struct snake {
     node_t* position;
     int snake_len;
+    int growth_pending;
 } snake_t;
 
+/** Cell log struct. Records the index (`width * row + col`) of every cell
+ * written by `update`, so that consumers can follow the board without
+ * rescanning it. Indices may repeat.
+ * Fields:
+ *  - indices: the logged cell indices.
+ *  - count: number of indices logged since the last call to `update`.
+ *  - capacity: number of indices that fit in `indices`.
+ *  - overflow: 1 if a write could not be logged (the log could not grow);
+ *    consumers should then resynchronize from the whole board.
+ */
+typedef struct cell_log {
+    size_t* indices;
+    size_t count;
+    size_t capacity;
+    int overflow;
+} cell_log_t;
+
+// Cell log filled in by `update`, or NULL if nobody is following the board.
+// There is one log at a time: whoever owns it claims it with
+// `cell_log_claim`, and every consumer reads that same log.
+extern cell_log_t* g_cell_log;
+
+int cell_log_claim(cell_log_t* log);
+void cell_log_release(cell_log_t* log);
+
 void set_seed(unsigned seed);
 unsigned generate_index(unsigned size);
 
@@ -0,0 +1,301 @@
+#include "connectivity.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "board_layout.h"
+#include "linked_list.h"
+#include "neighbor_table.h"
+
+#define NO_CELL NO_NEIGHBOR
+#define NO_NODE UINT_MAX
+
+/** Returns 1 if the cell with row-major index `index` can be moved onto:
+ * plain or food.
+ */
+static int is_free(const int* cells, size_t width, size_t index) {
+    int flag = cell_flag_at(cells, width, index);
+    return flag == FLAG_PLAIN_CELL || flag == FLAG_FOOD;
+}
+
+/** Allocates a tracker for a board of the given size. Call
+ * `connectivity_rebuild` before using it. Returns 0 on success and -1 if
+ * memory could not be allocated.
+ * Arguments:
+ *  - conn: the tracker to initialize.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+int connectivity_init(connectivity_t* conn, size_t width, size_t height) {
+    size_t count = width * height;
+
+    conn->width = width;
+    conn->height = height;
+    // room for every cell to free up once more between rebuilds
+    conn->capacity = 2 * count;
+    conn->node = malloc(count * sizeof(unsigned));
+    conn->parent = malloc(conn->capacity * sizeof(unsigned));
+    conn->size = malloc(conn->capacity * sizeof(unsigned));
+    conn->neighbors = neighbor_table_acquire(width, height);
+    conn->nodes = 0;
+    conn->dirty = 1;
+    conn->rebuilds = 0;
+
+    if (!conn->node || !conn->parent || !conn->size || !conn->neighbors) {
+        connectivity_free(conn);
+        return -1;
+    }
+    return 0;
+}
+
+/** Frees the tracker's buffers. */
+void connectivity_free(connectivity_t* conn) {
+    free(conn->node);
+    free(conn->parent);
+    free(conn->size);
+    neighbor_table_release(conn->neighbors);
+    conn->node = NULL;
+    conn->parent = NULL;
+    conn->size = NULL;
+    conn->neighbors = NULL;
+}
+
+/** Returns the root of `node`'s region, halving the path on the way. */
+static unsigned find(connectivity_t* conn, unsigned node) {
+    while (conn->parent[node] != node) {
+        conn->parent[node] = conn->parent[conn->parent[node]];
+        node = conn->parent[node];
+    }
+    return node;
+}
+
+/** Merges the regions of nodes `a` and `b`. */
+static void unite(connectivity_t* conn, unsigned a, unsigned b) {
+    a = find(conn, a);
+    b = find(conn, b);
+    if (a == b) {
+        return;
+    }
+    if (conn->size[a] < conn->size[b]) {
+        unsigned swap = a;
+        a = b;
+        b = swap;
+    }
+    conn->parent[b] = a;
+    conn->size[a] += conn->size[b];
+}
+
+/** Gives the free cell `index` a new node and joins it with the regions of
+ * its free neighbors.
+ */
+static void add_cell(connectivity_t* conn, unsigned index) {
+    if (conn->nodes == conn->capacity) {
+        conn->dirty = 1;
+        return;
+    }
+    unsigned node = conn->nodes++;
+    conn->parent[node] = node;
+    conn->size[node] = 1;
+    conn->node[index] = node;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = neighbor_of(conn->neighbors, index, dir);
+        if (next != NO_CELL && conn->node[next] != NO_NODE) {
+            unite(conn, node, conn->node[next]);
+        }
+    }
+}
+
+/** Returns 1 if the free cells next to `index` stay connected to each other
+ * without it: walking the 8 cells around it, its free neighbors all fall in
+ * one run of free cells. Each cell in the ring touches the next, so cells in
+ * a run are connected whatever the rest of the board looks like. Returns 0
+ * when the cell may have been a cut point, which only a search can settle.
+ */
+static int ring_connected(const connectivity_t* conn, unsigned index) {
+    if (conn->width < 3 || conn->height < 3) {
+        // the ring would run into itself
+        return 0;
+    }
+    const unsigned* table = conn->neighbors;
+    unsigned up = neighbor_of(table, index, 0);
+    unsigned down = neighbor_of(table, index, 1);
+    unsigned ring[8] = {
+        up,
+        up != NO_CELL ? neighbor_of(table, up, 3) : NO_CELL,
+        neighbor_of(table, index, 3),
+        down != NO_CELL ? neighbor_of(table, down, 3) : NO_CELL,
+        down,
+        down != NO_CELL ? neighbor_of(table, down, 2) : NO_CELL,
+        neighbor_of(table, index, 2),
+        up != NO_CELL ? neighbor_of(table, up, 2) : NO_CELL,
+    };
+    int free_cells[8];
+    int start = -1;
+    for (int i = 0; i < 8; i++) {
+        free_cells[i] = ring[i] != NO_CELL && conn->node[ring[i]] != NO_NODE;
+        if (!free_cells[i]) {
+            start = i;
+        }
+    }
+    if (start < 0) {
+        return 1;
+    }
+
+    // count the runs that hold a neighbor (the even positions)
+    int runs = 0;
+    int in_run = 0;
+    int run_has_neighbor = 0;
+    for (int step = 1; step <= 8; step++) {
+        int i = (start + step) % 8;
+        if (free_cells[i]) {
+            in_run = 1;
+            run_has_neighbor |= i % 2 == 0;
+        } else if (in_run) {
+            runs += run_has_neighbor;
+            in_run = 0;
+            run_has_neighbor = 0;
+        }
+    }
+    return runs <= 1;
+}
+
+/** Takes the cell `index`, which is no longer free, out of its region. */
+static void remove_cell(connectivity_t* conn, unsigned index) {
+    conn->size[find(conn, conn->node[index])]--;
+    conn->node[index] = NO_NODE;
+    if (!ring_connected(conn, index)) {
+        conn->dirty = 1;
+    }
+}
+
+/** Recomputes every region from the board. */
+void connectivity_rebuild(connectivity_t* conn, const int* cells) {
+    size_t count = conn->width * conn->height;
+    for (size_t i = 0; i < count; i++) {
+        conn->node[i] = NO_NODE;
+    }
+    conn->nodes = 0;
+    conn->dirty = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (is_free(cells, conn->width, i)) {
+            add_cell(conn, i);
+        }
+    }
+    conn->rebuilds++;
+}
+
+/** Brings the regions up to date with the cells `update` wrote, as recorded
+ * in `log`. A log that overflowed marks the tracker for a rebuild instead.
+ * Arguments:
+ *  - conn: the tracker, in step with the board before the update.
+ *  - cells: the board after the update.
+ *  - log: the cell log filled in by that update.
+ */
+void connectivity_apply(connectivity_t* conn, const int* cells,
+                        const cell_log_t* log) {
+    if (log->overflow) {
+        conn->dirty = 1;
+    }
+    for (size_t i = 0; i < log->count && !conn->dirty; i++) {
+        unsigned index = log->indices[i];
+        int now_free = is_free(cells, conn->width, index);
+        int was_free = conn->node[index] != NO_NODE;
+        if (now_free && !was_free) {
+            add_cell(conn, index);
+        } else if (!now_free && was_free) {
+            remove_cell(conn, index);
+        }
+    }
+}
+
+/** Adds the size of `index`'s region to `*total` unless the cell is not free
+ * or its region is already among the `*count` roots in `roots`.
+ */
+static void count_region(connectivity_t* conn, unsigned index,
+                         unsigned* roots, int* count, size_t* total) {
+    if (index == NO_CELL || conn->node[index] == NO_NODE) {
+        return;
+    }
+    unsigned root = find(conn, conn->node[index]);
+    for (int i = 0; i < *count; i++) {
+        if (roots[i] == root) {
+            return;
+        }
+    }
+    roots[(*count)++] = root;
+    *total += conn->size[root];
+}
+
+/** Counts the free cells reachable from any of the `n` cells in `seeds`
+ * (at most 4). The tail counts as free, since it moves out of the way, so
+ * reaching it also reaches the regions on its far side.
+ */
+static size_t reach(connectivity_t* conn, const int* cells,
+                    const unsigned* seeds, int n, unsigned tail) {
+    if (conn->dirty) {
+        connectivity_rebuild(conn, cells);
+    }
+    unsigned roots[8];
+    int count = 0;
+    size_t total = 0;
+    int tail_reached = 0;
+    for (int i = 0; i < n; i++) {
+        tail_reached |= seeds[i] == tail;
+        count_region(conn, seeds[i], roots, &count, &total);
+    }
+    if (tail == NO_CELL || conn->node[tail] != NO_NODE) {
+        return total;
+    }
+    for (int dir = 0; dir < 4 && !tail_reached; dir++) {
+        unsigned next = neighbor_of(conn->neighbors, tail, dir);
+        if (next != NO_CELL && conn->node[next] != NO_NODE) {
+            unsigned root = find(conn, conn->node[next]);
+            for (int i = 0; i < count; i++) {
+                tail_reached |= roots[i] == root;
+            }
+        }
+    }
+    if (!tail_reached) {
+        return total;
+    }
+    total++;
+    for (int dir = 0; dir < 4; dir++) {
+        count_region(conn, neighbor_of(conn->neighbors, tail, dir), roots,
+                     &count, &total);
+    }
+    return total;
+}
+
+/** Returns the number of free cells reachable from `cell`, counting `cell`
+ * itself, as a search from it would find them. `tail` is the snake's tail
+ * cell, which counts as free.
+ */
+size_t connectivity_reachable_from(connectivity_t* conn, const int* cells,
+                                   size_t cell, size_t tail) {
+    unsigned seed = cell;
+    return reach(conn, cells, &seed, 1, tail);
+}
+
+/** Returns the number of free cells the snake's head can still reach, its
+ * tail included. Once that is too few for the snake to keep moving, the
+ * game can be called without playing it out.
+ * Arguments:
+ *  - conn: a tracker in step with the board.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - snake_p: pointer to the snake struct.
+ */
+size_t connectivity_reachable(connectivity_t* conn, const int* cells,
+                              snake_t* snake_p) {
+    int* head = get_first(snake_p -> position);
+    int* tail = get_last(snake_p -> position);
+    unsigned head_index = conn->width * head[0] + head[1];
+    unsigned seeds[4];
+    for (int dir = 0; dir < 4; dir++) {
+        seeds[dir] = neighbor_of(conn->neighbors, head_index, dir);
+    }
+    unsigned tail_index = snake_p -> snake_len > 1
+                              ? conn->width * tail[0] + tail[1]
+                              : NO_CELL;
+    return reach(conn, cells, seeds, 4, tail_index);
+}
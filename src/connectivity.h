@@ -0,0 +1,52 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <stddef.h>
+
+#include "common.h"
+
+/** Connectivity struct. Tracks which free cells (plain or food) are
+ * connected to each other, following the board through the cell log
+ * rather than searching it every tick.
+ *
+ * Regions are sets in a union-find forest. A cell that frees up gets a new
+ * node, joined with its free neighbors. A cell that fills up is only taken
+ * out of its region's count, unless the cells around it show it may have
+ * been the region's only link between two sides; the forest is then rebuilt
+ * from the board the next time it is queried.
+ * Fields:
+ *  - width, height: dimensions of the board.
+ *  - node: each cell's node, or UINT_MAX if the cell is not free.
+ *  - parent: each node's parent; roots are their own parent.
+ *  - size: number of free cells in the region of each root.
+ *  - nodes: number of nodes handed out since the last rebuild.
+ *  - capacity: number of nodes that fit before a rebuild is forced.
+ *  - neighbors: the shared neighbor table of the board (see
+ *    neighbor_table.h), as of when the tracker was initialized.
+ *  - dirty: 1 if the forest has to be rebuilt before it can be queried.
+ *  - rebuilds: number of full rebuilds so far.
+ */
+typedef struct connectivity {
+    size_t width;
+    size_t height;
+    unsigned* node;
+    unsigned* parent;
+    unsigned* size;
+    unsigned nodes;
+    unsigned capacity;
+    const unsigned* neighbors;
+    int dirty;
+    size_t rebuilds;
+} connectivity_t;
+
+int connectivity_init(connectivity_t* conn, size_t width, size_t height);
+void connectivity_free(connectivity_t* conn);
+void connectivity_rebuild(connectivity_t* conn, const int* cells);
+void connectivity_apply(connectivity_t* conn, const int* cells,
+                        const cell_log_t* log);
+size_t connectivity_reachable_from(connectivity_t* conn, const int* cells,
+                                   size_t cell, size_t tail);
+size_t connectivity_reachable(connectivity_t* conn, const int* cells,
+                              snake_t* snake_p);
+
+#endif
@@ -0,0 +1,280 @@
+#include "distance_field.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_layout.h"
+#include "neighbor_table.h"
+
+#define NO_CELL DISTANCE_NONE
+
+// What a cell is to the field; see `distance_field_t.kind`.
+enum { KIND_BLOCKED, KIND_FREE, KIND_FOOD };
+
+/** Returns the kind of the cell with row-major index `index`. */
+static unsigned char read_kind(const int* cells, size_t width, size_t index) {
+    int flag = cell_flag_at(cells, width, index);
+    return flag == FLAG_FOOD ? KIND_FOOD
+           : flag == FLAG_PLAIN_CELL ? KIND_FREE
+                                     : KIND_BLOCKED;
+}
+
+/** Allocates a distance field for a board of the given size. Call
+ * `distance_field_rebuild` before using it. Returns 0 on success and -1 if
+ * memory could not be allocated.
+ * Arguments:
+ *  - df: the field to initialize.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+int distance_field_init(distance_field_t* df, size_t width, size_t height) {
+    size_t count = width * height;
+
+    df->width = width;
+    df->height = height;
+    df->distance = malloc(count * sizeof(unsigned));
+    df->kind = calloc(count, 1);
+    df->stamp = calloc(count, sizeof(unsigned));
+    df->epoch = 0;
+    df->queue = malloc(count * sizeof(unsigned));
+    df->seeds = malloc(count * sizeof(unsigned));
+    df->order = malloc(count * sizeof(uint64_t));
+    df->neighbors = neighbor_table_acquire(width, height);
+    df->repair_limit = count / 8 + 64;
+    df->rebuilds = 0;
+
+    if (!df->distance || !df->kind || !df->stamp || !df->queue ||
+        !df->seeds || !df->order || !df->neighbors) {
+        distance_field_free(df);
+        return -1;
+    }
+    return 0;
+}
+
+/** Frees the field's buffers. */
+void distance_field_free(distance_field_t* df) {
+    free(df->distance);
+    free(df->kind);
+    free(df->stamp);
+    free(df->queue);
+    free(df->seeds);
+    free(df->order);
+    neighbor_table_release(df->neighbors);
+    df->distance = NULL;
+    df->kind = NULL;
+    df->stamp = NULL;
+    df->queue = NULL;
+    df->seeds = NULL;
+    df->order = NULL;
+    df->neighbors = NULL;
+}
+
+/** Recomputes the whole field from the board with a search outward from
+ * every food at once.
+ */
+void distance_field_rebuild(distance_field_t* df, const int* cells) {
+    size_t count = df->width * df->height;
+    size_t head = 0;
+    size_t tail = 0;
+    for (size_t i = 0; i < count; i++) {
+        df->kind[i] = read_kind(cells, df->width, i);
+        df->distance[i] = DISTANCE_NONE;
+        if (df->kind[i] == KIND_FOOD) {
+            df->distance[i] = 0;
+            df->queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        unsigned current = df->queue[head++];
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(df->neighbors, current, dir);
+            if (next != NO_CELL && df->kind[next] != KIND_BLOCKED &&
+                df->distance[next] == DISTANCE_NONE) {
+                df->distance[next] = df->distance[current] + 1;
+                df->queue[tail++] = next;
+            }
+        }
+    }
+    df->rebuilds++;
+}
+
+/** Returns one more than the smallest distance among the free neighbors of
+ * `index`, or DISTANCE_NONE if none of them reaches food.
+ */
+static unsigned through_neighbors(const distance_field_t* df,
+                                  unsigned index) {
+    unsigned best = DISTANCE_NONE;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = neighbor_of(df->neighbors, index, dir);
+        if (next != NO_CELL && df->distance[next] < best) {
+            best = df->distance[next];
+        }
+    }
+    return best == DISTANCE_NONE ? best : best + 1;
+}
+
+/** Spreads the distance of `start`, which just got shorter, to the cells
+ * it now gives a shorter way to food.
+ */
+static void lower_from(distance_field_t* df, unsigned start) {
+    size_t head = 0;
+    size_t tail = 0;
+    df->queue[tail++] = start;
+    while (head < tail) {
+        unsigned current = df->queue[head++];
+        unsigned distance = df->distance[current] + 1;
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(df->neighbors, current, dir);
+            if (next != NO_CELL && df->kind[next] != KIND_BLOCKED &&
+                distance < df->distance[next]) {
+                df->distance[next] = distance;
+                df->queue[tail++] = next;
+            }
+        }
+    }
+}
+
+/** Returns 1 if `index` still has a neighbor one step closer to food that
+ * the current repair has not cleared.
+ */
+static int still_supported(const distance_field_t* df, unsigned index) {
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = neighbor_of(df->neighbors, index, dir);
+        if (next != NO_CELL && df->stamp[next] != df->epoch &&
+            df->distance[next] + 1 == df->distance[index]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/** Repairs the field after `start`, whose kind has already been updated,
+ * stopped being food or stopped being free. Returns 0 on success and -1 if
+ * the repair would clear more than `repair_limit` cells, in which case the
+ * field has to be rebuilt.
+ */
+static int raise_from(distance_field_t* df, unsigned start) {
+    if (df->epoch == UINT_MAX) {
+        memset(df->stamp, 0, df->width * df->height * sizeof(unsigned));
+        df->epoch = 0;
+    }
+    unsigned epoch = ++df->epoch;
+
+    // Clear the cells whose every shortest way to food went through
+    // `start`, level by level: by the time a cell is looked at, every cell
+    // on the level before it that will be cleared already has been.
+    size_t cleared = 0;
+    df->stamp[start] = epoch;
+    df->seeds[cleared++] = start;
+    for (size_t i = 0; i < cleared; i++) {
+        unsigned current = df->seeds[i];
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(df->neighbors, current, dir);
+            if (next == NO_CELL || df->stamp[next] == epoch ||
+                df->kind[next] != KIND_FREE ||
+                df->distance[next] != df->distance[current] + 1 ||
+                still_supported(df, next)) {
+                continue;
+            }
+            if (cleared == df->repair_limit) {
+                return -1;
+            }
+            df->stamp[next] = epoch;
+            df->seeds[cleared++] = next;
+        }
+    }
+
+    // Give each cleared cell the best distance through the cells around
+    // the cleared area, then search outward from those in distance order.
+    for (size_t i = 0; i < cleared; i++) {
+        df->distance[df->seeds[i]] = DISTANCE_NONE;
+    }
+    size_t seeded = 0;
+    for (size_t i = 0; i < cleared; i++) {
+        unsigned cell = df->seeds[i];
+        if (df->kind[cell] == KIND_BLOCKED) {
+            continue;
+        }
+        df->distance[cell] = df->kind[cell] == KIND_FOOD
+                                 ? 0
+                                 : through_neighbors(df, cell);
+        if (df->distance[cell] != DISTANCE_NONE) {
+            df->order[seeded++] = (uint64_t)df->distance[cell] << 32 | cell;
+        }
+    }
+    qsort(df->order, seeded, sizeof(uint64_t), compare_keys);
+
+    size_t next_seed = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    while (next_seed < seeded || head < tail) {
+        unsigned current;
+        if (head == tail ||
+            (next_seed < seeded &&
+             (df->order[next_seed] >> 32) <=
+                 df->distance[df->queue[head]])) {
+            uint64_t key = df->order[next_seed++];
+            current = (unsigned)key;
+            if ((key >> 32) != df->distance[current]) {
+                // reached by a shorter way since it was seeded
+                continue;
+            }
+        } else {
+            current = df->queue[head++];
+        }
+        unsigned distance = df->distance[current] + 1;
+        for (int dir = 0; dir < 4; dir++) {
+            unsigned next = neighbor_of(df->neighbors, current, dir);
+            if (next != NO_CELL && df->stamp[next] == epoch &&
+                df->kind[next] != KIND_BLOCKED &&
+                distance < df->distance[next]) {
+                df->distance[next] = distance;
+                df->queue[tail++] = next;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Brings the field up to date with the cells `update` wrote, as recorded in
+ * `log`, recomputing it whole if the log overflowed or a repair grew past
+ * `repair_limit`.
+ * Arguments:
+ *  - df: the field, in step with the board before the update.
+ *  - cells: the board after the update.
+ *  - log: the cell log filled in by that update.
+ */
+void distance_field_apply(distance_field_t* df, const int* cells,
+                          const cell_log_t* log) {
+    int rebuild = log->overflow;
+    for (size_t i = 0; i < log->count && !rebuild; i++) {
+        unsigned index = log->indices[i];
+        unsigned char kind = read_kind(cells, df->width, index);
+        unsigned char was = df->kind[index];
+        if (kind == was) {
+            continue;
+        }
+        df->kind[index] = kind;
+
+        // losing food, or a free cell, can only make other cells farther
+        if (was == KIND_FOOD || kind == KIND_BLOCKED) {
+            rebuild = raise_from(df, index) != 0;
+            continue;
+        }
+        df->distance[index] =
+            kind == KIND_FOOD ? 0 : through_neighbors(df, index);
+        if (df->distance[index] != DISTANCE_NONE) {
+            lower_from(df, index);
+        }
+    }
+    if (rebuild) {
+        distance_field_rebuild(df, cells);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// Distance of a cell from which no food can be reached, and of every cell
+// that cannot be moved onto.
+#define DISTANCE_NONE ((unsigned)-1)
+
+/** Distance field struct. Holds, for every free cell (plain or food), the
+ * number of steps to the nearest food over free cells, and keeps it current
+ * by following the cell log instead of searching the board every tick.
+ *
+ * New food and freed cells only shorten distances, which a search outward
+ * from the cell fixes. Food eaten and cells filled can lengthen them: the
+ * cells whose every shortest path ran through the changed cell are cleared
+ * and searched again from the cells around them. A repair that would touch
+ * more than `repair_limit` cells recomputes the whole field instead.
+ * Fields:
+ *  - width, height: dimensions of the board.
+ *  - distance: each cell's distance, or DISTANCE_NONE.
+ *  - kind: what the field last saw in each cell: 0 blocked, 1 free,
+ *    2 food.
+ *  - stamp: per-cell stamp marking the cells cleared by the current repair.
+ *  - epoch: stamp of the current repair.
+ *  - queue, seeds: search buffers, one entry per cell.
+ *  - order: scratch for sorting a repair's cells by distance.
+ *  - neighbors: the shared neighbor table of the board (see
+ *    neighbor_table.h), as of when the field was initialized. Its
+ *    NO_NEIGHBOR is the same value as DISTANCE_NONE.
+ *  - repair_limit: largest repair done in place.
+ *  - rebuilds: number of full recomputations so far.
+ */
+typedef struct distance_field {
+    size_t width;
+    size_t height;
+    unsigned* distance;
+    unsigned char* kind;
+    unsigned* stamp;
+    unsigned epoch;
+    unsigned* queue;
+    unsigned* seeds;
+    uint64_t* order;
+    const unsigned* neighbors;
+    size_t repair_limit;
+    size_t rebuilds;
+} distance_field_t;
+
+int distance_field_init(distance_field_t* df, size_t width, size_t height);
+void distance_field_free(distance_field_t* df);
+void distance_field_rebuild(distance_field_t* df, const int* cells);
+void distance_field_apply(distance_field_t* df, const int* cells,
+                          const cell_log_t* log);
+
+/** Returns the number of steps from the cell with row-major index `index`
+ * to the nearest food, or DISTANCE_NONE.
+ */
+static inline unsigned distance_to_food(const distance_field_t* df,
+                                        size_t index) {
+    return df->distance[index];
+}
+
+/** Like `distance_to_food`, but also answers for a cell that cannot be moved
+ * onto, such as the snake's head: one step more than its nearest neighbor.
+ */
+static inline unsigned distance_from_cell(const distance_field_t* df,
+                                          size_t index) {
+    if (df->distance[index] != DISTANCE_NONE) {
+        return df->distance[index];
+    }
+    unsigned best = DISTANCE_NONE;
+    for (int dir = 0; dir < 4; dir++) {
+        unsigned next = df->neighbors[4 * index + dir];
+        if (next != DISTANCE_NONE && df->distance[next] < best) {
+            best = df->distance[next];
+        }
+    }
+    return best == DISTANCE_NONE ? DISTANCE_NONE : best + 1;
+}
+
+#endif
@@ -0,0 +1,189 @@
+#include "fast_forward.h"
+
+#include <stdint.h>
+
+#include "board_layout.h"
+#include "game.h"
+#include "items.h"
+#include "linked_list.h"
+#include "rules.h"
+
+/** Returns 1 if `input` leaves a snake heading in direction `dir` on its
+ * course, the way `update` resolves it: no input, the same direction, or
+ * (once the snake has eaten) the reverse, which is ignored.
+ */
+static int keeps_course(enum input_key input, int dir) {
+    return input == INPUT_NONE || (int)input == dir ||
+           (g_score != 0 && (int)input == (dir ^ 1));
+}
+
+/** Moves (`row`, `col`) `count` cells in direction `dir`. Returns 0 on
+ * success and -1 if that runs off a board that does not wrap.
+ */
+static int walk(long* row, long* col, int dir, long count, size_t width,
+                size_t height) {
+    long* coord = dir >> 1 ? col : row;
+    long size = dir >> 1 ? (long)width : (long)height;
+    long next = *coord + ((dir & 1) ? count : -count);
+    if (next < 0 || next >= size) {
+        if (!g_rules.wrap) {
+            return -1;
+        }
+        next = ((next % size) + size) % size;
+    }
+    *coord = next;
+    return 0;
+}
+
+/** Returns how many of the next `limit` ticks the item table can be skipped
+ * over: none of them may put down or expire a power-up.
+ */
+static size_t quiet_item_ticks(size_t limit) {
+    items_t* items = g_items;
+    if (!items) {
+        return limit;
+    }
+    if (g_rules.powerup_every) {
+        // the tick that reaches a multiple of powerup_every spawns one
+        size_t spawn = g_rules.powerup_every -
+                       items->tick % g_rules.powerup_every;
+        if (spawn - 1 < limit) {
+            limit = spawn - 1;
+        }
+    }
+    if (items->heap_count > 0) {
+        uint64_t expires = items->items[items->heap[0]].expires;
+        uint64_t left = expires > items->tick ? expires - items->tick : 0;
+        if (left == 0) {
+            limit = 0;
+        } else if (left - 1 < limit) {
+            limit = left - 1;
+        }
+    }
+    return limit;
+}
+
+/** Returns how many cells the head can travel straight ahead, up to
+ * `limit`, over cells that are plain now: moving there cannot eat, collide
+ * or run off the board.
+ */
+static size_t clear_run(const int* cells, size_t width, size_t height,
+                        const int* head, size_t limit) {
+    int dir = head[2];
+    // past this the ray would come back around to cells it already crossed
+    size_t span = (dir >> 1 ? width : height) - 1;
+    if (span < limit) {
+        limit = span;
+    }
+    long row = head[0];
+    long col = head[1];
+    size_t run = 0;
+    while (run < limit && walk(&row, &col, dir, 1, width, height) == 0 &&
+           cell_flag(cells, width, row, col) == FLAG_PLAIN_CELL) {
+        run++;
+    }
+    return run;
+}
+
+/** Moves the whole snake `count` cells straight ahead in one go. The head's
+ * path must be clear (see `clear_run`), no growth pending and every segment
+ * on a FLAG_SNAKE cell. Only the segments that end up on the new cells are
+ * touched: each is taken off the tail and put back in front of the head.
+ */
+static void slide(int* cells, size_t width, size_t height, snake_t* snake_p,
+                  size_t count) {
+    node_t* head_node = snake_p -> position;
+    node_t* last = head_node;
+    while (last -> next) {
+        last = last -> next;
+    }
+
+    int* head = head_node -> data;
+    int dir = head[2];
+    long head_row = head[0];
+    long head_col = head[1];
+    size_t moved = count < (size_t)snake_p -> snake_len
+                       ? count
+                       : (size_t)snake_p -> snake_len;
+
+    // the newest segments, oldest first: `count - j` cells past the head
+    for (size_t j = moved; j-- > 0;) {
+        node_t* node = last;
+        int* position = node -> data;
+        cells[cell_index(width, position[0], position[1])] = FLAG_PLAIN_CELL;
+
+        if (node != snake_p -> position) {
+            last = node -> prev;
+            last -> next = NULL;
+            node -> prev = NULL;
+            node -> next = snake_p -> position;
+            snake_p -> position -> prev = node;
+            snake_p -> position = node;
+        }
+
+        long row = head_row;
+        long col = head_col;
+        walk(&row, &col, dir, count - j, width, height);
+        position[0] = row;
+        position[1] = col;
+        position[2] = dir;
+    }
+
+    node_t* node = snake_p -> position;
+    for (size_t j = 0; j < moved; j++, node = node -> next) {
+        int* position = node -> data;
+        cells[cell_index(width, position[0], position[1])] = FLAG_SNAKE;
+    }
+}
+
+/** Plays `n` ticks of inputs, with the same result as calling `update` once
+ * for each of them. Stretches where the snake keeps its course over plain
+ * cells are applied in one step, so a replay costs per event (turn, meal,
+ * collision, power-up) rather than per tick. Ticks with a cell log attached
+ * go through `update`, since it records every tick's writes. Returns the
+ * number of inputs played, which is less than `n` if the game ended.
+ * Arguments:
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct.
+ *  - inputs: the input for each tick.
+ *  - n: number of ticks to play.
+ *  - growing: as for `update`.
+ */
+size_t advance(int* cells, size_t width, size_t height, snake_t* snake_p,
+               const enum input_key* inputs, size_t n, int growing) {
+    size_t i = 0;
+    while (i < n && !g_game_over) {
+        int* head = get_first(snake_p -> position);
+        size_t straight = 0;
+        // a head that just followed the tail sits on a cell `update` left
+        // plain; one regular step puts the board back in line with the snake
+        if (!g_cell_log && snake_p -> growth_pending == 0 &&
+            cell_flag(cells, width, head[0], head[1]) == FLAG_SNAKE) {
+            while (i + straight < n &&
+                   keeps_course(inputs[i + straight], head[2])) {
+                straight++;
+            }
+            straight = quiet_item_ticks(straight);
+            straight = clear_run(cells, width, height, head, straight);
+        }
+
+        if (straight > 0) {
+            slide(cells, width, height, snake_p, straight);
+            if (g_items) {
+                g_items -> tick += straight;
+                g_items -> boost_left = g_items -> boost_left > straight
+                                            ? g_items -> boost_left - straight
+                                            : 0;
+            }
+            i += straight;
+            continue;
+        }
+
+        update(cells, width, height, snake_p, inputs[i], growing);
+        i++;
+    }
+    return i;
+}
@@ -0,0 +1,11 @@
+#ifndef FAST_FORWARD_H
+#define FAST_FORWARD_H
+
+#include <stddef.h>
+
+#include "common.h"
+
+size_t advance(int* cells, size_t width, size_t height, snake_t* snake_p,
+               const enum input_key* inputs, size_t n, int growing);
+
+#endif
@@ -0,0 +1,154 @@
+#include "frame.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "board_layout.h"
+#include "common.h"
+
+// Longest output for one cell: a color escape plus the 3-byte wall glyph.
+#define MAX_CELL_BYTES 8
+// Room for the score line and the per-row endings.
+#define MAX_HEADER_BYTES 64
+#define MAX_ROW_END_BYTES 8
+
+#define ANSI_HOME "\x1b[H"
+#define ANSI_CLEAR_LINE "\x1b[K"
+#define ANSI_RESET "\x1b[0m"
+
+// UTF-8 encoding of U+2588 FULL BLOCK, the wall glyph used by `render_game`.
+#define WALL_GLYPH "\xe2\x96\x88"
+
+// Colors matching the pairs set up by `initialize_window`.
+enum frame_color { COLOR_NONE, COLOR_SNAKE, COLOR_WALL, COLOR_FOOD };
+
+static const char* const color_codes[] = {
+    ANSI_RESET,
+    "\x1b[33m",  // yellow
+    "\x1b[34m",  // blue
+    "\x1b[31m",  // red
+};
+
+/** Allocates a frame buffer large enough for any board of the given size.
+ * Returns 0 on success and -1 if memory could not be allocated.
+ * Arguments:
+ *  - frame: the frame to initialize.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - ansi: 1 for colored terminal frames, 0 for plain text.
+ */
+int frame_init(frame_t* frame, size_t width, size_t height, int ansi) {
+    frame->capacity = width * height * MAX_CELL_BYTES +
+                      height * MAX_ROW_END_BYTES + MAX_HEADER_BYTES;
+    frame->buffer = malloc(frame->capacity);
+    frame->length = 0;
+    frame->ansi = ansi;
+    return frame->buffer ? 0 : -1;
+}
+
+/** Frees the frame buffer. */
+void frame_free(frame_t* frame) {
+    free(frame->buffer);
+    frame->buffer = NULL;
+}
+
+/** Appends `len` bytes to the frame; the buffer is sized so this never
+ * overflows.
+ */
+static char* put(char* out, const char* bytes, size_t len) {
+    memcpy(out, bytes, len);
+    return out + len;
+}
+
+/** Draws the board and score into the frame buffer, replacing the previous
+ * frame.
+ * Arguments:
+ *  - frame: an initialized frame sized for this board.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+void frame_render(frame_t* frame, const int* cells, size_t width,
+                  size_t height) {
+    char* out = frame->buffer;
+    int ansi = frame->ansi;
+
+    if (ansi) {
+        out = put(out, ANSI_HOME, strlen(ANSI_HOME));
+    }
+    out += snprintf(out, MAX_HEADER_BYTES / 2, "SCORE: %d%s", g_score,
+                    g_game_over ? "  GAME OVER" : "");
+    if (ansi) {
+        out = put(out, ANSI_CLEAR_LINE, strlen(ANSI_CLEAR_LINE));
+    }
+    *out++ = '\n';
+
+    enum frame_color current = COLOR_NONE;
+    for (size_t row = 0; row < height; row++) {
+        for (size_t col = 0; col < width; col++) {
+            int cell = cell_flag(cells, width, row, col);
+            enum frame_color color;
+            const char* glyph;
+            size_t glyph_len = 1;
+
+            // same precedence as `render_game`
+            if (cell & FLAG_SNAKE) {
+                color = COLOR_SNAKE;
+                glyph = "S";
+            } else if (cell & FLAG_FOOD) {
+                color = COLOR_FOOD;
+                glyph = "O";
+            } else if (cell & FLAG_WALL) {
+                color = COLOR_WALL;
+                glyph = WALL_GLYPH;
+                glyph_len = strlen(WALL_GLYPH);
+            } else {
+                color = COLOR_NONE;
+                glyph = ansi ? " " : ".";
+            }
+
+            if (ansi && color != current) {
+                out = put(out, color_codes[color], strlen(color_codes[color]));
+                current = color;
+            }
+            out = put(out, glyph, glyph_len);
+        }
+        if (ansi && current != COLOR_NONE) {
+            out = put(out, ANSI_RESET, strlen(ANSI_RESET));
+            current = COLOR_NONE;
+        }
+        *out++ = '\n';
+    }
+    if (!ansi) {
+        // blank line between frames, as in the autograder's verbose output
+        *out++ = '\n';
+    }
+
+    frame->length = out - frame->buffer;
+}
+
+/** Writes the last rendered frame to `fd`. Only a short write or an
+ * interrupted call makes this issue more than one `write`.
+ * Returns 0 on success and -1 on error (with errno set).
+ */
+int frame_write(frame_t* frame, int fd) {
+    const char* out = frame->buffer;
+    size_t left = frame->length;
+
+    while (left > 0) {
+        ssize_t written = write(fd, out, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        out += written;
+        left -= written;
+    }
+    return 0;
+}
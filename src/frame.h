@@ -0,0 +1,28 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+
+/** Frame struct. A headless renderer that draws the board into one
+ * preallocated buffer so that a whole frame goes out in a single `write`.
+ * Fields:
+ *  - buffer: the frame bytes.
+ *  - capacity: size of `buffer`, enough for the worst-case frame.
+ *  - length: number of bytes in the last rendered frame.
+ *  - ansi: 1 to draw like `render_game` (colors, cursor homed at the top of
+ *    the terminal), 0 for plain text frames like the autograder's.
+ */
+typedef struct frame {
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    int ansi;
+} frame_t;
+
+int frame_init(frame_t* frame, size_t width, size_t height, int ansi);
+void frame_free(frame_t* frame);
+void frame_render(frame_t* frame, const int* cells, size_t width,
+                  size_t height);
+int frame_write(frame_t* frame, int fd);
+
+#endif
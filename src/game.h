@@ -10,5 +10,6 @@ void update(int* cells, size_t width, size_t height, snake_t* snake_p,
             enum input_key input, int growing);
 void place_food(int* cells, size_t width, size_t height);
 void teardown(int* cells, snake_t* snake_p);
+void game_shutdown(void);
 
 #endif
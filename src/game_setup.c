@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "board_alloc.h"
+#include "board_layout.h"
 #include "common.h"
 #include "game.h"
 #include "linked_list.h"
@@ -24,6 +26,9 @@
  * Modifies values pointed to by cells_p, width_p, and height_p and initializes
  * cells array to reflect this default board.
  *
+ * With `g_layout.lazy` set, the board is left zero-filled: the walls around
+ * the edge and the plain cells are implicit, and only the snake is written.
+ *
  * Returns INIT_SUCCESS to indicate that it was successful.
  *
  * Arguments:
@@ -38,26 +43,34 @@ enum board_init_status initialize_default_board(int** cells_p, size_t* width_p,
                                                 size_t* height_p) {
     *width_p = 20;
     *height_p = 10;
-    int* cells = malloc(20 * 10 * sizeof(int));
+    size_t storage = layout_init(&g_layout, 20, 10);
+    if (g_layout.lazy) {
+        int* cells = board_alloc_zeroed(storage * sizeof(int));
+        *cells_p = cells;
+        cells[cell_index(20, 2, 2)] = FLAG_SNAKE;
+        return INIT_SUCCESS;
+    }
+
+    int* cells = board_alloc(storage * sizeof(int));
     *cells_p = cells;
     for (int i = 0; i < 20 * 10; i++) {
-        cells[i] = FLAG_PLAIN_CELL;
+        cells[cell_offset(20, i)] = FLAG_PLAIN_CELL;
     }
 
     // Set edge cells!
     // Top and bottom edges:
     for (int i = 0; i < 20; ++i) {
-        cells[i] = FLAG_WALL;
-        cells[i + (20 * (10 - 1))] = FLAG_WALL;
+        cells[cell_index(20, 0, i)] = FLAG_WALL;
+        cells[cell_index(20, 10 - 1, i)] = FLAG_WALL;
     }
     // Left and right edges:
     for (int i = 0; i < 10; ++i) {
-        cells[i * 20] = FLAG_WALL;
-        cells[i * 20 + 20 - 1] = FLAG_WALL;
+        cells[cell_index(20, i, 0)] = FLAG_WALL;
+        cells[cell_index(20, i, 20 - 1)] = FLAG_WALL;
     }
 
     // Add snake
-    cells[20 * 2 + 2] = FLAG_SNAKE;
+    cells[cell_index(20, 2, 2)] = FLAG_SNAKE;
 
     return INIT_SUCCESS;
 }
@@ -91,6 +104,8 @@ enum board_init_status initialize_game(int** cells_p, size_t* width_p,
 
         insert_first(&snake_p -> position, position, sizeof(int) * 3);
     }
+    snake_p -> snake_len = 1;
+    snake_p -> growth_pending = 0;
     g_game_over = 0;
     g_score = 0;
     place_food(*cells_p, *width_p, *height_p);
@@ -115,9 +130,10 @@ enum board_init_status decompress_board_str(int** cells_p, size_t* width_p,
                                             size_t* height_p, snake_t* snake_p,
                                             char* compressed) {
     char** main_save_ptr = &compressed;
-    char size_delimiter = 'x';
-    char delimiter = DELIMITER;
-    char* board_argument = strtok_r(compressed, &delimiter, main_save_ptr);
+    // strtok_r takes delimiter strings, so these must be NUL-terminated
+    char size_delimiter[] = {'x', '\0'};
+    char delimiter[] = {DELIMITER, '\0'};
+    char* board_argument = strtok_r(compressed, delimiter, main_save_ptr);
     char** board_save_ptr = &board_argument;
     char temp = board_argument[0];
 
@@ -131,18 +147,19 @@ enum board_init_status decompress_board_str(int** cells_p, size_t* width_p,
 
     board_argument[0] = '0';
 
-    *height_p = atoi(strtok_r(board_argument, &size_delimiter, board_save_ptr));
-    *width_p = atoi(strtok_r(NULL, &size_delimiter, board_save_ptr));
+    *height_p = atoi(strtok_r(board_argument, size_delimiter, board_save_ptr));
+    *width_p = atoi(strtok_r(NULL, size_delimiter, board_save_ptr));
 
-    int* cells = malloc(*height_p * *width_p * sizeof(int));
+    size_t storage = layout_init(&g_layout, *width_p, *height_p);
+    int* cells = g_layout.lazy ? board_alloc_zeroed(storage * sizeof(int))
+                               : board_alloc(storage * sizeof(int));
     *cells_p = cells;
-    int* current_position = *cells_p;
 
     if (temp != 'B') {
         return INIT_ERR_BAD_CHAR;
     }
 
-    board_argument = strtok_r(NULL, &delimiter, main_save_ptr);
+    board_argument = strtok_r(NULL, delimiter, main_save_ptr);
 
     while (board_argument != NULL) {
         if (current_height > *height_p) {
@@ -198,8 +215,13 @@ enum board_init_status decompress_board_str(int** cells_p, size_t* width_p,
             }
 
             for (int i = 0; i < current_run; i++) {
-                *current_position = current_flag;
-                current_position++;
+                size_t col = current_width - current_run + i;
+                size_t row = current_height - 1;
+                // a lazy board leaves cells that read right when unset alone
+                if (g_layout.lazy && current_flag == implicit_flag(row, col)) {
+                    continue;
+                }
+                cells[cell_index(*width_p, row, col)] = current_flag;
             }
 
         }
@@ -209,7 +231,7 @@ enum board_init_status decompress_board_str(int** cells_p, size_t* width_p,
         }
 
         current_height += 1;
-        board_argument = strtok_r(NULL, &delimiter, main_save_ptr);
+        board_argument = strtok_r(NULL, delimiter, main_save_ptr);
     }
 
     if (current_height-1 < *height_p) {
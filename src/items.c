@@ -0,0 +1,193 @@
+#include "items.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_layout.h"
+#include "common.h"
+
+items_t* g_items;
+
+/** Sets up an item table for the given board and registers the food already
+ * on it. Returns 0 on success and -1 if memory could not be allocated.
+ * Arguments:
+ *  - items: the table to initialize.
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ */
+int items_init(items_t* items, const int* cells, size_t width,
+               size_t height) {
+    memset(items, 0, sizeof(*items));
+    items->cell_count = width * height;
+    items->slot = malloc(items->cell_count * sizeof(size_t));
+    if (!items->slot) {
+        return -1;
+    }
+    for (size_t i = 0; i < items->cell_count; i++) {
+        items->slot[i] = NO_ITEM;
+    }
+
+    for (size_t i = 0; i < items->cell_count; i++) {
+        if (cell_flag_at(cells, width, i) == FLAG_FOOD &&
+            items_add(items, i, ITEM_FOOD, 0) != 0) {
+            items_free(items);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/** Frees the item table. */
+void items_free(items_t* items) {
+    if (g_items == items) {
+        g_items = NULL;
+    }
+    free(items->slot);
+    free(items->items);
+    free(items->heap);
+    memset(items, 0, sizeof(*items));
+}
+
+/** Returns 1 if item `a` expires before item `b`. */
+static int expires_before(const items_t* items, size_t a, size_t b) {
+    return items->items[a].expires < items->items[b].expires;
+}
+
+/** Puts heap entry `i` in `items->heap` at position `pos`. */
+static void heap_set(items_t* items, size_t pos, size_t i) {
+    items->heap[pos] = i;
+    items->items[i].heap_index = pos;
+}
+
+/** Restores the heap order around position `pos`, moving its entry up or
+ * down as needed.
+ */
+static void heap_fix(items_t* items, size_t pos) {
+    size_t i = items->heap[pos];
+
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!expires_before(items, i, items->heap[parent])) {
+            break;
+        }
+        heap_set(items, pos, items->heap[parent]);
+        pos = parent;
+    }
+
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= items->heap_count) {
+            break;
+        }
+        if (child + 1 < items->heap_count &&
+            expires_before(items, items->heap[child + 1], items->heap[child])) {
+            child++;
+        }
+        if (!expires_before(items, items->heap[child], i)) {
+            break;
+        }
+        heap_set(items, pos, items->heap[child]);
+        pos = child;
+    }
+    heap_set(items, pos, i);
+}
+
+/** Adds an item on an empty cell. Returns 0 on success and -1 if memory
+ * could not be allocated.
+ * Arguments:
+ *  - items: the item table.
+ *  - cell: index of the item's cell.
+ *  - kind: the kind of item.
+ *  - expires: tick at which the item disappears, or 0 if it stays until
+ *    eaten.
+ */
+int items_add(items_t* items, size_t cell, enum item_kind kind,
+              uint64_t expires) {
+    if (items->count == items->capacity) {
+        size_t capacity = items->capacity ? items->capacity * 2 : 16;
+        item_t* grown = realloc(items->items, capacity * sizeof(item_t));
+        if (!grown) {
+            return -1;
+        }
+        items->items = grown;
+        size_t* heap = realloc(items->heap, capacity * sizeof(size_t));
+        if (!heap) {
+            return -1;
+        }
+        items->heap = heap;
+        items->capacity = capacity;
+    }
+
+    size_t i = items->count++;
+    items->items[i] = (item_t){
+        .cell = cell,
+        .expires = expires,
+        .heap_index = NO_ITEM,
+        .kind = kind,
+    };
+    items->slot[cell] = i;
+    items->live[kind]++;
+
+    if (expires != 0) {
+        items->heap[items->heap_count] = i;
+        items->items[i].heap_index = items->heap_count++;
+        heap_fix(items, items->heap_count - 1);
+    }
+    return 0;
+}
+
+/** Removes the item at index `i` in `items->items`. */
+static void remove_item(items_t* items, size_t i) {
+    item_t* item = &items->items[i];
+
+    if (item->heap_index != NO_ITEM) {
+        size_t pos = item->heap_index;
+        size_t last = --items->heap_count;
+        if (pos != last) {
+            heap_set(items, pos, items->heap[last]);
+            heap_fix(items, pos);
+        }
+    }
+    items->slot[item->cell] = NO_ITEM;
+    items->live[item->kind]--;
+
+    // fill the gap with the last item
+    size_t last = --items->count;
+    if (i != last) {
+        items->items[i] = items->items[last];
+        items->slot[items->items[i].cell] = i;
+        if (items->items[i].heap_index != NO_ITEM) {
+            items->heap[items->items[i].heap_index] = i;
+        }
+    }
+}
+
+/** Removes the item on `cell`, if any, storing its kind in `kind_p`.
+ * Returns 1 if there was an item and 0 otherwise.
+ */
+int items_take(items_t* items, size_t cell, enum item_kind* kind_p) {
+    size_t i = items->slot[cell];
+    if (i == NO_ITEM) {
+        return 0;
+    }
+    *kind_p = items->items[i].kind;
+    remove_item(items, i);
+    return 1;
+}
+
+/** Removes one item whose expiry tick has been reached, storing its cell in
+ * `cell_p`. Returns 1 if an item expired and 0 if none is due; call until it
+ * returns 0.
+ */
+int items_expire(items_t* items, size_t* cell_p) {
+    if (items->heap_count == 0 ||
+        items->items[items->heap[0]].expires > items->tick) {
+        return 0;
+    }
+    size_t i = items->heap[0];
+    *cell_p = items->items[i].cell;
+    remove_item(items, i);
+    return 1;
+}
@@ -0,0 +1,75 @@
+#ifndef ITEMS_H
+#define ITEMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Slot value for a cell without an item.
+#define NO_ITEM SIZE_MAX
+
+/** Kinds of item. Every item occupies a FLAG_FOOD cell; the item table tells
+ * them apart.
+ *  - ITEM_FOOD: scores a point and grows the snake.
+ *  - ITEM_SPEED: speeds the game up for a while.
+ *  - ITEM_SHRINK: takes segments off the tail.
+ */
+enum item_kind { ITEM_FOOD, ITEM_SPEED, ITEM_SHRINK, ITEM_KINDS };
+
+/** Item struct. One item on the board.
+ * Fields:
+ *  - cell: index of the item's cell.
+ *  - expires: tick at which the item disappears, or 0 if it never does.
+ *  - heap_index: position in the expiry heap (for items that expire).
+ *  - kind: what the item does when eaten.
+ */
+typedef struct item {
+    size_t cell;
+    uint64_t expires;
+    size_t heap_index;
+    enum item_kind kind;
+} item_t;
+
+/** Item table struct. Tracks every item on the board: looking up the item
+ * on a cell is O(1), and adding, eating or expiring one is O(log K) for K
+ * items.
+ * Fields:
+ *  - cell_count: number of cells on the board.
+ *  - slot: for each cell, the index of its item in `items`, or NO_ITEM.
+ *  - items: the items, packed; `count` in use out of `capacity`.
+ *  - heap: min-heap of indices into `items`, ordered by expiry, holding the
+ *    `heap_count` items that expire.
+ *  - live: number of items of each kind.
+ *  - tick: ticks played so far; expiry times are measured against it.
+ *  - boost_left: ticks left on the current speed boost.
+ */
+typedef struct items {
+    size_t cell_count;
+    size_t* slot;
+    item_t* items;
+    size_t count;
+    size_t capacity;
+    size_t* heap;
+    size_t heap_count;
+    size_t live[ITEM_KINDS];
+    uint64_t tick;
+    unsigned boost_left;
+} items_t;
+
+// Item table `update` and `place_food` keep up to date, or NULL to play with
+// plain food only.
+extern items_t* g_items;
+
+int items_init(items_t* items, const int* cells, size_t width, size_t height);
+void items_free(items_t* items);
+int items_add(items_t* items, size_t cell, enum item_kind kind,
+              uint64_t expires);
+int items_take(items_t* items, size_t cell, enum item_kind* kind_p);
+int items_expire(items_t* items, size_t* cell_p);
+
+/** Returns the item on `cell`, or NULL if there is none. */
+static inline item_t* items_at(const items_t* items, size_t cell) {
+    size_t slot = items->slot[cell];
+    return slot == NO_ITEM ? NULL : &items->items[slot];
+}
+
+#endif
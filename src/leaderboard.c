@@ -0,0 +1,378 @@
+#include "leaderboard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Longest name a record may hold; anything longer in the log is corruption.
+#define MAX_NAME_LEN 4096
+
+/** Log record header, in host byte order. Followed by `name_len` bytes of
+ * name (not NUL-terminated). `crc` covers everything after itself: the rest
+ * of the header and the name.
+ */
+typedef struct record_header {
+    uint32_t crc;
+    int32_t score;
+    uint32_t name_len;
+} record_header_t;
+
+/** Returns the CRC-32 (IEEE) of `len` bytes at `bytes`, continuing from
+ * `crc` (0 to start).
+ */
+static uint32_t crc32_update(uint32_t crc, const void* bytes, size_t len) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    const unsigned char* p = bytes;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t record_crc(const record_header_t* header, const char* name) {
+    uint32_t crc = crc32_update(0, &header->score,
+                                sizeof(*header) - sizeof(header->crc));
+    return crc32_update(crc, name, header->name_len);
+}
+
+/** FNV-1a hash of a name. */
+static uint64_t hash_name(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/** Returns the slot holding `name`, or the empty slot where it belongs. */
+static player_t* find_player(const leaderboard_t* lb, const char* name,
+                             uint64_t hash) {
+    size_t mask = lb->player_capacity - 1;
+    size_t i = hash & mask;
+    while (lb->players[i].name &&
+           (lb->players[i].hash != hash ||
+            strcmp(lb->players[i].name, name) != 0)) {
+        i = (i + 1) & mask;
+    }
+    return &lb->players[i];
+}
+
+/** Doubles the player table. Returns 0 on success and -1 on error. */
+static int grow_players(leaderboard_t* lb) {
+    size_t capacity = lb->player_capacity ? lb->player_capacity * 2 : 64;
+    player_t* old = lb->players;
+    size_t old_capacity = lb->player_capacity;
+
+    lb->players = calloc(capacity, sizeof(player_t));
+    if (!lb->players) {
+        lb->players = old;
+        return -1;
+    }
+    lb->player_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].name) {
+            *find_player(lb, old[i].name, old[i].hash) = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/** Returns 1 if `entry` ranks ahead of a game scoring `score` at log
+ * position `seq`.
+ */
+static int ranks_ahead(const score_entry_t* entry, int score, uint64_t seq) {
+    return entry->score > score || (entry->score == score && entry->seq < seq);
+}
+
+/** Picks the height of a new tower: each level with probability 1/4. */
+static int random_level(leaderboard_t* lb) {
+    int level = 1;
+    while (level < SKIP_MAX_LEVEL) {
+        lb->rng ^= lb->rng << 13;
+        lb->rng ^= lb->rng >> 7;
+        lb->rng ^= lb->rng << 17;
+        if (lb->rng & 3) {
+            break;
+        }
+        level++;
+    }
+    return level;
+}
+
+/** Adds a game to the index. Returns 0 on success and -1 on error. */
+static int index_game(leaderboard_t* lb, const char* name, int score) {
+    if ((lb->player_count + 1) * 2 > lb->player_capacity &&
+        grow_players(lb) != 0) {
+        return -1;
+    }
+    uint64_t hash = hash_name(name);
+    player_t* player = find_player(lb, name, hash);
+    if (!player->name) {
+        player->name = strdup(name);
+        if (!player->name) {
+            return -1;
+        }
+        player->hash = hash;
+        player->best = NULL;
+        lb->player_count++;
+    }
+
+    int level = random_level(lb);
+    score_entry_t* entry =
+        malloc(sizeof(score_entry_t) + level * sizeof(skip_link_t));
+    if (!entry) {
+        return -1;
+    }
+    entry->name = player->name;
+    entry->score = score;
+    entry->seq = lb->count;
+    entry->level = level;
+
+    // find the entry after which the new one goes on each level, counting
+    // how many entries precede each of them
+    score_entry_t* update[SKIP_MAX_LEVEL];
+    size_t rank[SKIP_MAX_LEVEL];
+    score_entry_t* x = lb->head;
+    for (int i = lb->level - 1; i >= 0; i--) {
+        rank[i] = i == lb->level - 1 ? 0 : rank[i + 1];
+        while (x->links[i].next &&
+               ranks_ahead(x->links[i].next, score, entry->seq)) {
+            rank[i] += x->links[i].span;
+            x = x->links[i].next;
+        }
+        update[i] = x;
+    }
+    for (int i = lb->level; i < level; i++) {
+        rank[i] = 0;
+        update[i] = lb->head;
+        lb->head->links[i].next = NULL;
+        lb->head->links[i].span = lb->count;
+    }
+    if (level > lb->level) {
+        lb->level = level;
+    }
+
+    for (int i = 0; i < level; i++) {
+        skip_link_t* prev = &update[i]->links[i];
+        entry->links[i].next = prev->next;
+        entry->links[i].span = prev->span - (rank[0] - rank[i]);
+        prev->next = entry;
+        prev->span = rank[0] - rank[i] + 1;
+    }
+    for (int i = level; i < lb->level; i++) {
+        update[i]->links[i].span++;
+    }
+    lb->count++;
+
+    if (!player->best || player->best->score < score) {
+        player->best = entry;
+    }
+    return 0;
+}
+
+/** Reads the log at `path` into the index and cuts off anything after the
+ * last intact record, which is what a crash in the middle of an append
+ * leaves behind. Returns 0 on success and -1 on error.
+ */
+static int load_log(leaderboard_t* lb, const char* path) {
+    FILE* log = fopen(path, "rb");
+    if (!log) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    char name[MAX_NAME_LEN + 1];
+    record_header_t header;
+    long valid = 0;
+    while (fread(&header, sizeof(header), 1, log) == 1 &&
+           header.name_len <= MAX_NAME_LEN &&
+           fread(name, 1, header.name_len, log) == header.name_len &&
+           record_crc(&header, name) == header.crc) {
+        name[header.name_len] = '\0';
+        if (index_game(lb, name, header.score) != 0) {
+            fclose(log);
+            return -1;
+        }
+        valid += sizeof(header) + header.name_len;
+    }
+
+    int torn = !feof(log) || ftell(log) != valid;
+    fclose(log);
+    if (torn && truncate(path, valid) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/** Opens the leaderboard whose log is at `path`, creating the log if it does
+ * not exist, and loads every recorded game. Returns 0 on success and -1 on
+ * error (with errno set).
+ * Arguments:
+ *  - lb: the leaderboard to open.
+ *  - path: filesystem path of the score log.
+ *  - sync_every: number of records to write between fsyncs; a crash loses at
+ *    most this many of the latest games. 0 or 1 syncs every record.
+ */
+int leaderboard_open(leaderboard_t* lb, const char* path, unsigned sync_every) {
+    memset(lb, 0, sizeof(*lb));
+    lb->fd = -1;
+    lb->sync_every = sync_every ? sync_every : 1;
+    lb->rng = 0x9E3779B97F4A7C15ull;
+    lb->head =
+        calloc(1, sizeof(score_entry_t) + SKIP_MAX_LEVEL * sizeof(skip_link_t));
+    if (!lb->head) {
+        errno = ENOMEM;
+        return -1;
+    }
+    lb->head->level = SKIP_MAX_LEVEL;
+    lb->level = 1;
+
+    if (load_log(lb, path) != 0) {
+        int saved = errno;
+        leaderboard_close(lb);
+        errno = saved;
+        return -1;
+    }
+    lb->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (lb->fd < 0) {
+        int saved = errno;
+        leaderboard_close(lb);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/** Records a finished game: appends it to the log and adds it to the index.
+ * Returns 0 on success and -1 on error. A game whose write succeeded but
+ * whose sync failed is still indexed.
+ * Arguments:
+ *  - lb: an open leaderboard.
+ *  - name: the player's name.
+ *  - score: the game's score.
+ */
+int leaderboard_record(leaderboard_t* lb, const char* name, int score) {
+    size_t name_len = strlen(name);
+    if (name_len > MAX_NAME_LEN) {
+        name_len = MAX_NAME_LEN;
+    }
+
+    // one write per record, so that a crash tears at most the last one; the
+    // extra byte terminates the name for the index
+    char record[sizeof(record_header_t) + MAX_NAME_LEN + 1];
+    record_header_t header = {.score = score, .name_len = (uint32_t)name_len};
+    header.crc = record_crc(&header, name);
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), name, name_len);
+
+    size_t size = sizeof(header) + name_len;
+    ssize_t written;
+    do {
+        written = write(lb->fd, record, size);
+    } while (written < 0 && errno == EINTR);
+    if (written != (ssize_t)size) {
+        return -1;
+    }
+    lb->unsynced++;
+
+    // the record is in the log from here on, so it is indexed even if the
+    // sync below fails; otherwise the index would disagree with the file
+    record[sizeof(header) + name_len] = '\0';
+    if (index_game(lb, record + sizeof(header), score) != 0) {
+        return -1;
+    }
+    return lb->unsynced >= lb->sync_every ? leaderboard_sync(lb) : 0;
+}
+
+/** Flushes every recorded game to disk. Returns 0 on success and -1 on
+ * error.
+ */
+int leaderboard_sync(leaderboard_t* lb) {
+    if (lb->unsynced == 0) {
+        return 0;
+    }
+    if (fdatasync(lb->fd) != 0) {
+        return -1;
+    }
+    lb->unsynced = 0;
+    return 0;
+}
+
+/** Fills `out` with the `k` best games, best first. Returns the number of
+ * entries written, which is less than `k` if fewer games were recorded.
+ */
+size_t leaderboard_top(const leaderboard_t* lb, size_t k,
+                       const score_entry_t** out) {
+    size_t n = 0;
+    for (const score_entry_t* x = lb->head->links[0].next; x && n < k;
+         x = x->links[0].next) {
+        out[n++] = x;
+    }
+    return n;
+}
+
+/** Returns the rank (1 for the best) that a game scoring `score` holds:
+ * one more than the number of games that scored higher.
+ */
+size_t leaderboard_rank(const leaderboard_t* lb, int score) {
+    size_t rank = 0;
+    const score_entry_t* x = lb->head;
+    for (int i = lb->level - 1; i >= 0; i--) {
+        while (x->links[i].next && x->links[i].next->score > score) {
+            rank += x->links[i].span;
+            x = x->links[i].next;
+        }
+    }
+    return rank + 1;
+}
+
+/** Returns the rank of the player's best game, or 0 if the player has no
+ * recorded games.
+ */
+size_t leaderboard_player_rank(const leaderboard_t* lb, const char* name) {
+    if (lb->player_count == 0) {
+        return 0;
+    }
+    const player_t* player = find_player(lb, name, hash_name(name));
+    if (!player->name) {
+        return 0;
+    }
+    return leaderboard_rank(lb, player->best->score);
+}
+
+/** Syncs the log and frees the leaderboard. */
+void leaderboard_close(leaderboard_t* lb) {
+    if (lb->fd >= 0) {
+        leaderboard_sync(lb);
+        close(lb->fd);
+    }
+    if (lb->head) {
+        score_entry_t* x = lb->head->links[0].next;
+        while (x) {
+            score_entry_t* next = x->links[0].next;
+            free(x);
+            x = next;
+        }
+        free(lb->head);
+    }
+    for (size_t i = 0; i < lb->player_capacity; i++) {
+        free(lb->players[i].name);
+    }
+    free(lb->players);
+    memset(lb, 0, sizeof(*lb));
+    lb->fd = -1;
+}
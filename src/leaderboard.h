@@ -0,0 +1,86 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tallest tower in the skip list; plenty for billions of entries.
+#define SKIP_MAX_LEVEL 32
+
+/** Skip link struct. One level of an entry's tower.
+ * Fields:
+ *  - next: the following entry on this level.
+ *  - span: how many entries `next` moves past, so that ranks can be counted
+ *    on the way down.
+ */
+typedef struct skip_link {
+    struct score_entry* next;
+    size_t span;
+} skip_link_t;
+
+/** Score entry struct. One recorded game in the in-memory index, kept in a
+ * skip list ordered by score (highest first), ties broken by whoever got
+ * there first.
+ * Fields:
+ *  - name: the player's name, shared by all of that player's entries.
+ *  - score: the game's score.
+ *  - seq: position of the game in the log.
+ *  - level: number of levels in `links`.
+ *  - links: the entry's tower.
+ */
+typedef struct score_entry {
+    const char* name;
+    int score;
+    uint64_t seq;
+    int level;
+    skip_link_t links[];
+} score_entry_t;
+
+/** Player struct. One slot of the table from names to best entries.
+ * Fields:
+ *  - name: the player's name, or NULL for an empty slot.
+ *  - hash: hash of `name`.
+ *  - best: the player's highest-ranked entry.
+ */
+typedef struct player {
+    char* name;
+    uint64_t hash;
+    score_entry_t* best;
+} player_t;
+
+/** Leaderboard struct. Every result is appended to a log file, which is read
+ * back into the index when the leaderboard is opened.
+ * Fields:
+ *  - fd: the log file, opened for appending.
+ *  - sync_every: the log is fsync'd once this many records are unsynced.
+ *  - unsynced: records written since the last fsync.
+ *  - head: skip list sentinel with SKIP_MAX_LEVEL levels.
+ *  - level: number of levels in use.
+ *  - count: number of entries.
+ *  - players: open-addressing table of `player_capacity` slots (a power of
+ *    two), holding `player_count` players.
+ *  - rng: random state for picking entry levels.
+ */
+typedef struct leaderboard {
+    int fd;
+    unsigned sync_every;
+    unsigned unsynced;
+    score_entry_t* head;
+    int level;
+    size_t count;
+    player_t* players;
+    size_t player_capacity;
+    size_t player_count;
+    uint64_t rng;
+} leaderboard_t;
+
+int leaderboard_open(leaderboard_t* lb, const char* path, unsigned sync_every);
+int leaderboard_record(leaderboard_t* lb, const char* name, int score);
+size_t leaderboard_top(const leaderboard_t* lb, size_t k,
+                       const score_entry_t** out);
+size_t leaderboard_rank(const leaderboard_t* lb, int score);
+size_t leaderboard_player_rank(const leaderboard_t* lb, const char* name);
+int leaderboard_sync(leaderboard_t* lb);
+void leaderboard_close(leaderboard_t* lb);
+
+#endif
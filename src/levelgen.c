@@ -0,0 +1,325 @@
+#include "levelgen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Returns the next number from the generator's xorshift64* stream. */
+static uint64_t next_random(levelgen_t* gen) {
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+    return gen->rng * 2685821657736338717ull;
+}
+
+/** Returns a random bit, taking them 64 at a time from the stream. */
+static int coin(levelgen_t* gen) {
+    if (gen->bits_left == 0) {
+        gen->bits = next_random(gen);
+        gen->bits_left = 64;
+    }
+    gen->bits_left--;
+    return (gen->bits >> gen->bits_left) & 1;
+}
+
+/** Reads the name of a level kind (maze, rooms or pillars). Returns 0 on
+ * success and -1 if the name is not a kind.
+ */
+int level_kind_parse(const char* name, enum level_kind* kind_p) {
+    static const char* names[] = {"maze", "rooms", "pillars"};
+    for (int kind = LEVEL_MAZE; kind <= LEVEL_PILLARS; kind++) {
+        if (strcmp(name, names[kind]) == 0) {
+            *kind_p = kind;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/** Sets up a generator. Mazes and rooms shrink the board to the largest
+ * whole grid that fits; `gen->width` and `gen->height` hold the size that
+ * will be generated. Returns 0 on success and -1 if memory could not be
+ * allocated or the board is too small: the snake starts at (1, 1) heading
+ * right, so (1, 2) has to be open, which takes a width of at least 4 and,
+ * for mazes and rooms, one whole grid cell.
+ * Arguments:
+ *  - gen: the generator to set up.
+ *  - kind: what to generate.
+ *  - height: height of the board wanted.
+ *  - width: width of the board wanted.
+ *  - cell: side of each room, in board cells; mazes always use 1.
+ *  - density: chance that each pillar spot holds a pillar.
+ *  - seed: seed for the level; the same seed gives the same level.
+ */
+int levelgen_init(levelgen_t* gen, enum level_kind kind, size_t height,
+                  size_t width, size_t cell, double density, uint64_t seed) {
+    memset(gen, 0, sizeof(*gen));
+    gen->kind = kind;
+    gen->cell = kind == LEVEL_MAZE ? 1 : cell;
+    gen->density = density;
+    // xorshift gets stuck at 0
+    gen->rng = (seed ^ 0x9e3779b97f4a7c15ull) | 1;
+
+    if (kind == LEVEL_PILLARS) {
+        gen->width = width;
+        gen->height = height;
+        return width >= 4 && height >= 3 ? 0 : -1;
+    }
+    if (gen->cell == 0) {
+        return -1;
+    }
+    size_t stride = gen->cell + 1;
+    gen->columns = width > 0 ? (width - 1) / stride : 0;
+    size_t rows = height > 0 ? (height - 1) / stride : 0;
+    if (gen->columns == 0 || rows == 0) {
+        return -1;
+    }
+    gen->width = gen->columns * stride + 1;
+    gen->height = rows * stride + 1;
+    // a single one-cell-wide column walls the snake in from the start
+    if (gen->width < 4) {
+        return -1;
+    }
+
+    size_t columns = gen->columns;
+    gen->label = malloc(columns * sizeof(size_t));
+    gen->parent = malloc(columns * sizeof(size_t));
+    gen->remaining = malloc(columns * sizeof(size_t));
+    gen->opened = malloc(columns);
+    gen->joined = malloc(columns);
+    gen->down = malloc(columns);
+    if (!gen->label || !gen->parent || !gen->remaining || !gen->opened ||
+        !gen->joined || !gen->down) {
+        levelgen_free(gen);
+        return -1;
+    }
+    // the first grid row starts with every cell in a set of its own
+    for (size_t c = 0; c < columns; c++) {
+        gen->label[c] = c;
+    }
+    return 0;
+}
+
+/** Frees the generator's buffers. */
+void levelgen_free(levelgen_t* gen) {
+    free(gen->label);
+    free(gen->parent);
+    free(gen->remaining);
+    free(gen->opened);
+    free(gen->joined);
+    free(gen->down);
+    gen->label = NULL;
+    gen->parent = NULL;
+    gen->remaining = NULL;
+    gen->opened = NULL;
+    gen->joined = NULL;
+    gen->down = NULL;
+}
+
+static size_t find(size_t* parent, size_t set) {
+    while (parent[set] != set) {
+        parent[set] = parent[parent[set]];
+        set = parent[set];
+    }
+    return set;
+}
+
+/** Runs one row of Eller's algorithm: decides which neighbors in the
+ * current grid row are joined and which cells open downward, then labels
+ * the sets of the next grid row. Sets are labeled 0 to `columns - 1`, so
+ * the bookkeeping never grows with the height.
+ */
+static void plan_grid_row(levelgen_t* gen, int first, int last) {
+    // byte stores may alias `gen`, so the arrays are read into locals once
+    size_t columns = gen->columns;
+    size_t* label = gen->label;
+    size_t* parent = gen->parent;
+    size_t* remaining = gen->remaining;
+    unsigned char* opened = gen->opened;
+    unsigned char* joined = gen->joined;
+    unsigned char* down = gen->down;
+    for (size_t c = 0; c < columns; c++) {
+        parent[c] = c;
+    }
+
+    // join neighbors in different sets; joining within a set would close
+    // a loop. The last row has to join everything still apart, and the
+    // first always opens to the right of (1, 1), where the snake starts
+    // out heading.
+    for (size_t c = 0; c + 1 < columns; c++) {
+        size_t a = find(parent, label[c]);
+        size_t b = find(parent, label[c + 1]);
+        // bitwise rather than short-circuit, since the coin flips are
+        // unpredictable branches
+        int join = (a != b) & (last | coin(gen) | (first & (c == 0)));
+        joined[c] = join;
+        parent[b] = join ? a : b;
+    }
+    joined[columns - 1] = 0;
+    for (size_t c = 0; c < columns; c++) {
+        label[c] = find(parent, label[c]);
+        remaining[c] = 0;
+        opened[c] = 0;
+    }
+    for (size_t c = 0; c < columns; c++) {
+        remaining[label[c]]++;
+    }
+
+    // open at least one way down from every set, so none is cut off
+    for (size_t c = 0; c < columns; c++) {
+        size_t set = label[c];
+        remaining[set]--;
+        int forced = (remaining[set] == 0) & !opened[set];
+        down[c] = (last == 0) & (coin(gen) | forced);
+        opened[set] |= down[c];
+    }
+
+    // cells below an opening carry their set down; the rest start new sets
+    // under the labels no set carried down
+    size_t free_label = 0;
+    for (size_t c = 0; c < columns; c++) {
+        if (down[c]) {
+            continue;
+        }
+        while (opened[free_label]) {
+            free_label++;
+        }
+        label[c] = free_label++;
+    }
+}
+
+/** Fills `row` with board row `r` of a maze or rooms level. */
+static void grid_row(levelgen_t* gen, size_t r, char* row) {
+    size_t cell = gen->cell;
+    size_t stride = cell + 1;
+    size_t grid_rows = (gen->height - 1) / stride;
+    if (r == 0) {
+        memset(row, 'W', gen->width);
+        return;
+    }
+    size_t grid = (r - 1) / stride;
+    size_t within = (r - 1) % stride;
+    if (within == 0) {
+        plan_grid_row(gen, grid == 0, grid + 1 == grid_rows);
+    }
+    size_t columns = gen->columns;
+    const unsigned char* joined = gen->joined;
+    const unsigned char* down = gen->down;
+    // doors and ways down are one cell wide, in the middle of the wall
+    size_t door = cell / 2;
+
+    row[0] = 'W';
+    char* out = row + 1;
+    if (within < cell) {
+        int door_row = within == door;
+        for (size_t c = 0; c < columns; c++, out += stride) {
+            for (size_t i = 0; i < cell; i++) {
+                out[i] = 'E';
+            }
+            out[cell] = joined[c] & door_row ? 'E' : 'W';
+        }
+    } else {
+        for (size_t c = 0; c < columns; c++, out += stride) {
+            for (size_t i = 0; i < stride; i++) {
+                out[i] = 'W';
+            }
+            out[door] = down[c] ? 'E' : 'W';
+        }
+    }
+}
+
+/** Fills `row` with board row `r` of a pillars level. Pillars only stand
+ * where row and column are both even, so every cell with an odd row or
+ * column is open and they all connect.
+ */
+static void pillars_row(levelgen_t* gen, size_t r, char* row) {
+    if (r == 0 || r + 1 == gen->height) {
+        memset(row, 'W', gen->width);
+        return;
+    }
+    row[0] = 'W';
+    for (size_t c = 1; c + 1 < gen->width; c++) {
+        double draw = (next_random(gen) >> 11) * (1.0 / 9007199254740992.0);
+        row[c] = r % 2 == 0 && c % 2 == 0 && draw < gen->density ? 'W' : 'E';
+    }
+    row[gen->width - 1] = 'W';
+}
+
+/** Produces the next board row as `gen->width` characters ('E' plain, 'W'
+ * wall, 'S' snake) in `row`. Returns 0 on success and -1 once every row
+ * has been produced.
+ */
+int levelgen_next_row(levelgen_t* gen, char* row) {
+    if (gen->row == gen->height) {
+        return -1;
+    }
+    if (gen->kind == LEVEL_PILLARS) {
+        pillars_row(gen, gen->row, row);
+    } else {
+        grid_row(gen, gen->row, row);
+    }
+    if (gen->row == 1) {
+        row[1] = 'S';
+    }
+    gen->row++;
+    return 0;
+}
+
+/** Writes `n` in decimal at `out`. Returns the number of digits. */
+static size_t write_count(size_t n, char* out) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+/** Run-length encodes a row of `width` characters the way
+ * `decompress_board_str` reads it, e.g. "W1E3W1". `out` needs room for
+ * `2 * width + 1` bytes. Returns the length written, not counting the
+ * terminating NUL.
+ */
+size_t levelgen_encode_row(const char* row, size_t width, char* out) {
+    size_t length = 0;
+    size_t start = 0;
+    while (start < width) {
+        size_t end = start + 1;
+        while (end < width && row[end] == row[start]) {
+            end++;
+        }
+        // a run of n takes 1 + digits(n) <= 2n bytes
+        out[length++] = row[start];
+        length += write_count(end - start, out + length);
+        start = end;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/** Writes the whole level to `out` as a board string ("B<height>x<width>"
+ * and a '|' before each encoded row), followed by a newline. Returns 0 on
+ * success and -1 if memory could not be allocated or writing failed.
+ */
+int levelgen_write(levelgen_t* gen, FILE* out) {
+    char* row = malloc(gen->width);
+    char* encoded = malloc(2 * gen->width + 1);
+    if (!row || !encoded) {
+        free(row);
+        free(encoded);
+        return -1;
+    }
+    fprintf(out, "B%zux%zu", gen->height, gen->width);
+    while (levelgen_next_row(gen, row) == 0) {
+        size_t length = levelgen_encode_row(row, gen->width, encoded);
+        fputc('|', out);
+        fwrite(encoded, 1, length, out);
+    }
+    fputc('\n', out);
+    free(row);
+    free(encoded);
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,67 @@
+#ifndef LEVELGEN_H
+#define LEVELGEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Kinds of generated level.
+ *  - LEVEL_MAZE: a perfect maze of one-cell corridors.
+ *  - LEVEL_ROOMS: square rooms joined by one-cell doors, laid out as a
+ *    maze of rooms.
+ *  - LEVEL_PILLARS: an open walled board with single-cell pillars.
+ */
+enum level_kind { LEVEL_MAZE, LEVEL_ROOMS, LEVEL_PILLARS };
+
+/** Level generator struct. Produces a level one board row at a time, in
+ * memory proportional to its width, so boards of any height can be
+ * streamed. Every open cell of a generated level can be reached from every
+ * other, and the snake starts at (1, 1).
+ *
+ * Mazes and rooms are grids of `cell` x `cell` open areas with a wall
+ * between neighbors, built with Eller's algorithm: each grid row joins
+ * some neighbors in different sets, then opens at least one way down from
+ * every set, so each set stays connected without remembering earlier rows;
+ * the last row joins whatever sets are left.
+ * Fields:
+ *  - kind: what to generate.
+ *  - width, height: dimensions of the board.
+ *  - cell: side of a maze cell or room, in board cells.
+ *  - density: chance that each pillar spot holds a pillar.
+ *  - rng: xorshift state.
+ *  - bits, bits_left: random bits not yet used by coin flips.
+ *  - row: the next board row to produce.
+ *  - columns: number of grid cells across.
+ *  - label, parent, remaining, opened: Eller's set bookkeeping, one entry
+ *    per grid column.
+ *  - joined: 1 if grid cell `c` of the current grid row opens onto `c + 1`.
+ *  - down: 1 if grid cell `c` opens onto the grid row below.
+ */
+typedef struct levelgen {
+    enum level_kind kind;
+    size_t width;
+    size_t height;
+    size_t cell;
+    double density;
+    uint64_t rng;
+    uint64_t bits;
+    int bits_left;
+    size_t row;
+    size_t columns;
+    size_t* label;
+    size_t* parent;
+    size_t* remaining;
+    unsigned char* opened;
+    unsigned char* joined;
+    unsigned char* down;
+} levelgen_t;
+
+int level_kind_parse(const char* name, enum level_kind* kind_p);
+int levelgen_init(levelgen_t* gen, enum level_kind kind, size_t height,
+                  size_t width, size_t cell, double density, uint64_t seed);
+void levelgen_free(levelgen_t* gen);
+int levelgen_next_row(levelgen_t* gen, char* row);
+size_t levelgen_encode_row(const char* row, size_t width, char* out);
+int levelgen_write(levelgen_t* gen, FILE* out);
+
+#endif
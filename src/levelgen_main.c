@@ -0,0 +1,66 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "levelgen.h"
+
+// Writes a generated level to stdout as a board string for `snake` and
+// `snake-server`, e.g.
+//   $ ./snake 0 0 "$(./snake-levelgen --kind rooms 40 120)"
+// Rows are written as they are generated, so the board can be far larger
+// than memory when piped to a file.
+
+static void usage(void) {
+    printf(
+        "usage: snake-levelgen [--kind maze|rooms|pillars] [--room N] "
+        "[--density P] [--seed SEED] HEIGHT WIDTH\n");
+}
+
+int main(int argc, char** argv) {
+    enum level_kind kind = LEVEL_MAZE;
+    size_t room = 5;
+    double density = 0.3;
+    uint64_t seed = 1;
+
+    static struct option options[] = {
+        {"kind", required_argument, NULL, 'k'},
+        {"room", required_argument, NULL, 'r'},
+        {"density", required_argument, NULL, 'd'},
+        {"seed", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'k':
+                if (level_kind_parse(optarg, &kind) != 0) {
+                    usage();
+                    return 1;
+                }
+                break;
+            case 'r': room = strtoul(optarg, NULL, 10); break;
+            case 'd': density = atof(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            default: usage(); return 1;
+        }
+    }
+    if (optind + 2 != argc) {
+        usage();
+        return 1;
+    }
+    size_t height = strtoul(argv[optind], NULL, 10);
+    size_t width = strtoul(argv[optind + 1], NULL, 10);
+
+    levelgen_t gen;
+    if (levelgen_init(&gen, kind, height, width, room, density, seed) != 0) {
+        fprintf(stderr, "cannot generate a %zux%zu level\n", height, width);
+        return 1;
+    }
+    int status = levelgen_write(&gen, stdout);
+    levelgen_free(&gen);
+    if (status != 0) {
+        fprintf(stderr, "could not write the level\n");
+        return 1;
+    }
+    return 0;
+}
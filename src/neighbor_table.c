@@ -0,0 +1,92 @@
+#include "neighbor_table.h"
+
+#include <stdlib.h>
+
+#include "rules.h"
+
+/** A shared table and what it was built for.
+ * Fields:
+ *  - next: the next shared table.
+ *  - width, height, wrap: the board the table describes.
+ *  - refs: number of holders.
+ *  - table: 4 neighbors per cell.
+ */
+typedef struct shared_table {
+    struct shared_table* next;
+    size_t width;
+    size_t height;
+    int wrap;
+    size_t refs;
+    unsigned table[];
+} shared_table_t;
+
+// Tables in use; there is usually just one board, so this stays short.
+static shared_table_t* s_tables;
+
+static void build(shared_table_t* shared) {
+    size_t width = shared->width;
+    size_t height = shared->height;
+    int wrap = shared->wrap;
+    for (size_t row = 0; row < height; row++) {
+        for (size_t col = 0; col < width; col++) {
+            unsigned* out = &shared->table[4 * (width * row + col)];
+            size_t up = row > 0 ? row - 1 : height - 1;
+            size_t down = row + 1 < height ? row + 1 : 0;
+            size_t left = col > 0 ? col - 1 : width - 1;
+            size_t right = col + 1 < width ? col + 1 : 0;
+            out[0] = row > 0 || wrap ? width * up + col : NO_NEIGHBOR;
+            out[1] =
+                row + 1 < height || wrap ? width * down + col : NO_NEIGHBOR;
+            out[2] = col > 0 || wrap ? width * row + left : NO_NEIGHBOR;
+            out[3] =
+                col + 1 < width || wrap ? width * row + right : NO_NEIGHBOR;
+        }
+    }
+}
+
+/** Returns the neighbor table of a board of the given size under the
+ * current `g_rules.wrap`, building it if nobody holds one yet, or NULL if
+ * memory could not be allocated. Give it back with
+ * `neighbor_table_release`.
+ */
+const unsigned* neighbor_table_acquire(size_t width, size_t height) {
+    int wrap = g_rules.wrap;
+    for (shared_table_t* shared = s_tables; shared; shared = shared->next) {
+        if (shared->width == width && shared->height == height &&
+            shared->wrap == wrap) {
+            shared->refs++;
+            return shared->table;
+        }
+    }
+
+    shared_table_t* shared =
+        malloc(sizeof(shared_table_t) + 4 * width * height * sizeof(unsigned));
+    if (!shared) {
+        return NULL;
+    }
+    shared->width = width;
+    shared->height = height;
+    shared->wrap = wrap;
+    shared->refs = 1;
+    build(shared);
+    shared->next = s_tables;
+    s_tables = shared;
+    return shared->table;
+}
+
+/** Gives back a table from `neighbor_table_acquire`, freeing it once nobody
+ * holds it. NULL is ignored.
+ */
+void neighbor_table_release(const unsigned* table) {
+    for (shared_table_t** link = &s_tables; *link; link = &(*link)->next) {
+        shared_table_t* shared = *link;
+        if (shared->table != table) {
+            continue;
+        }
+        if (--shared->refs == 0) {
+            *link = shared->next;
+            free(shared);
+        }
+        return;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+
+#include <limits.h>
+#include <stddef.h>
+
+// Neighbor of a cell on the edge of a board that does not wrap.
+#define NO_NEIGHBOR UINT_MAX
+
+// A neighbor table holds, for every cell of a board (by row-major index
+// `width * row + col`), the cell one step away in each direction (0 up,
+// 1 down, 2 left, 3 right), wrapping around the edges if `g_rules.wrap` is
+// set when the table is made. Trackers of the same board share one table
+// instead of paying 16 bytes per cell each. Not thread-safe.
+
+const unsigned* neighbor_table_acquire(size_t width, size_t height);
+void neighbor_table_release(const unsigned* table);
+
+/** Returns the cell one step from `index` in direction `dir`, or
+ * NO_NEIGHBOR if the step leaves the board.
+ */
+static inline unsigned neighbor_of(const unsigned* table, unsigned index,
+                                   int dir) {
+    return table[4 * index + dir];
+}
+
+#endif
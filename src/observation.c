@@ -0,0 +1,315 @@
+#include "observation.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "board_layout.h"
+#include "linked_list.h"
+
+// The flag each plane is built from; the head plane is handled separately.
+static const int plane_flags[PLANE_HEAD] = {FLAG_WALL, FLAG_SNAKE, FLAG_FOOD};
+
+/** Copies `n` cells into bytes. Cell values are FLAG_* bits, so they always
+ * fit in a byte.
+ */
+static void narrow_u8(const int* src, unsigned char* dst, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 12));
+        __m128i lo = _mm_packs_epi32(a, b);
+        __m128i hi = _mm_packs_epi32(c, d);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (unsigned char)src[i];
+    }
+}
+
+/** Copies `n` cells into floats. */
+static void widen_f32(const int* src, float* dst, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(v));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (float)src[i];
+    }
+}
+
+/** Writes a one-hot byte plane: 1 where the cell has `flag` set. */
+static void plane_u8(const int* src, unsigned char* dst, size_t n, int flag) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i f = _mm_set1_epi32(flag);
+    __m128i one = _mm_set1_epi8(1);
+    for (; i + 16 <= n; i += 16) {
+        __m128i m[4];
+        for (int k = 0; k < 4; k++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i + 4 * k));
+            m[k] = _mm_cmpeq_epi32(_mm_and_si128(v, f), f);
+        }
+        // all-ones lanes stay all-ones through the signed packs
+        __m128i lo = _mm_packs_epi32(m[0], m[1]);
+        __m128i hi = _mm_packs_epi32(m[2], m[3]);
+        __m128i bytes = _mm_and_si128(_mm_packs_epi16(lo, hi), one);
+        _mm_storeu_si128((__m128i*)(dst + i), bytes);
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (src[i] & flag) == flag;
+    }
+}
+
+/** Writes a one-hot float plane: 1.0 where the cell has `flag` set. */
+static void plane_f32(const int* src, float* dst, size_t n, int flag) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i f = _mm_set1_epi32(flag);
+    __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 m = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, f), f));
+        _mm_storeu_ps(dst + i, _mm_and_ps(m, one));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (src[i] & flag) == flag ? 1.0f : 0.0f;
+    }
+}
+
+/** Returns how many of the `n` cells of a row starting at column `col` are
+ * stored one after another, starting with the first. With the row-major
+ * layout the whole row is; tiled layouts break it up at tile edges.
+ */
+static size_t contiguous_run(size_t col, size_t n) {
+    if (!g_layout.row_offset) {
+        return n;
+    }
+    size_t start = g_layout.col_offset[col];
+    size_t len = 1;
+    while (len < n && g_layout.col_offset[col + len] == start + len) {
+        len++;
+    }
+    return len;
+}
+
+/** Replaces the FLAG_UNSET values among `n` window bytes copied from row
+ * `row`, starting at column `col`, with what those cells read as.
+ */
+static void resolve_u8(unsigned char* dst, size_t n, size_t row, size_t col) {
+    for (size_t i = 0; i < n; i++) {
+        if (dst[i] == FLAG_UNSET) {
+            dst[i] = implicit_flag(row, col + i);
+        }
+    }
+}
+
+/** Like `resolve_u8`, for float windows. */
+static void resolve_f32(float* dst, size_t n, size_t row, size_t col) {
+    for (size_t i = 0; i < n; i++) {
+        if (dst[i] == FLAG_UNSET) {
+            dst[i] = implicit_flag(row, col + i);
+        }
+    }
+}
+
+/** Marks the unset edge cells of a lazy board in a wall plane; unset cells
+ * elsewhere are plain, which no plane records.
+ */
+static void resolve_wall_plane(const int* cells, size_t width, size_t height,
+                               unsigned char* plane_u8_out,
+                               float* plane_f32_out) {
+    for (size_t row = 0; row < height; row++) {
+        size_t step =
+            row == 0 || row + 1 == height || width < 2 ? 1 : width - 1;
+        for (size_t col = 0; col < width; col += step) {
+            if (cells[cell_index(width, row, col)] != FLAG_UNSET) {
+                continue;
+            }
+            if (plane_u8_out) {
+                plane_u8_out[width * row + col] = 1;
+            } else {
+                plane_f32_out[width * row + col] = 1.0f;
+            }
+        }
+    }
+}
+
+/** Computes which part of a window row lies on the board. Window columns
+ * [*first, *last) map to board columns starting at `*board_start`.
+ */
+static void clip_window(size_t center, size_t radius, size_t size,
+                        size_t* first, size_t* last, size_t* board_start) {
+    size_t span = 2 * radius + 1;
+    *first = center < radius ? radius - center : 0;
+    *board_start = center + *first - radius;
+    *last = span;
+    if (*board_start + (span - *first) > size) {
+        *last = *first + (size > *board_start ? size - *board_start : 0);
+    }
+}
+
+/** Writes the (2 * radius + 1) x (2 * radius + 1) cells centered on the snake's
+ * head into `out`, row by row, as FLAG_* values. Cells past the edge of the
+ * board read as FLAG_WALL.
+ * Arguments:
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct.
+ *  - radius: how many cells to include on each side of the head.
+ *  - out: buffer of WINDOW_CELLS(radius) bytes.
+ */
+void encode_window_u8(const int* cells, size_t width, size_t height,
+                      snake_t* snake_p, size_t radius, unsigned char* out) {
+    int* head = get_first(snake_p->position);
+    size_t span = 2 * radius + 1;
+    size_t first_row, last_row, first_col, last_col, board_row, board_col;
+
+    clip_window(head[0], radius, height, &first_row, &last_row, &board_row);
+    clip_window(head[1], radius, width, &first_col, &last_col, &board_col);
+
+    memset(out, FLAG_WALL, span * span);
+    size_t n = last_col - first_col;
+    for (size_t r = first_row; r < last_row; r++, board_row++) {
+        for (size_t c = 0, run; c < n; c += run) {
+            run = contiguous_run(board_col + c, n - c);
+            unsigned char* dst = out + span * r + first_col + c;
+            narrow_u8(cells + cell_index(width, board_row, board_col + c),
+                      dst, run);
+            if (g_layout.lazy) {
+                resolve_u8(dst, run, board_row, board_col + c);
+            }
+        }
+    }
+}
+
+/** Like `encode_window_u8`, but writes the FLAG_* values as floats. */
+void encode_window_f32(const int* cells, size_t width, size_t height,
+                       snake_t* snake_p, size_t radius, float* out) {
+    int* head = get_first(snake_p->position);
+    size_t span = 2 * radius + 1;
+    size_t first_row, last_row, first_col, last_col, board_row, board_col;
+
+    clip_window(head[0], radius, height, &first_row, &last_row, &board_row);
+    clip_window(head[1], radius, width, &first_col, &last_col, &board_col);
+
+    for (size_t r = 0; r < span; r++) {
+        float* row_out = out + span * r;
+        if (r < first_row || r >= last_row) {
+            for (size_t c = 0; c < span; c++) {
+                row_out[c] = FLAG_WALL;
+            }
+            continue;
+        }
+        for (size_t c = 0; c < first_col; c++) {
+            row_out[c] = FLAG_WALL;
+        }
+        size_t n = last_col - first_col;
+        for (size_t c = 0, run; c < n; c += run) {
+            run = contiguous_run(board_col + c, n - c);
+            float* dst = row_out + first_col + c;
+            widen_f32(cells + cell_index(width, board_row, board_col + c),
+                      dst, run);
+            if (g_layout.lazy) {
+                resolve_f32(dst, run, board_row, board_col + c);
+            }
+        }
+        for (size_t c = last_col; c < span; c++) {
+            row_out[c] = FLAG_WALL;
+        }
+        board_row++;
+    }
+}
+
+/** Returns 1 if the head at `head` is on a board of the given size. */
+static int head_on_board(const int* head, size_t width, size_t height) {
+    return head[0] >= 0 && head[1] >= 0 && (size_t)head[0] < height &&
+           (size_t)head[1] < width;
+}
+
+/** Writes PLANE_COUNT one-hot planes of `width * height` bytes each, in
+ * `enum obs_plane` order, into `out`. The head plane is all 0 once the
+ * head has run off the board.
+ * Arguments:
+ *  - cells: a pointer to the first integer in an array of integers
+ *    representing each board cell.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - snake_p: pointer to the snake struct.
+ *  - out: buffer of PLANE_COUNT * width * height bytes.
+ */
+void encode_planes_u8(const int* cells, size_t width, size_t height,
+                      snake_t* snake_p, unsigned char* out) {
+    size_t count = width * height;
+    int* head = get_first(snake_p->position);
+
+    for (int p = 0; p < PLANE_HEAD; p++) {
+        if (!g_layout.row_offset) {
+            plane_u8(cells, out + p * count, count, plane_flags[p]);
+            continue;
+        }
+        for (size_t row = 0; row < height; row++) {
+            for (size_t col = 0, run; col < width; col += run) {
+                run = contiguous_run(col, width - col);
+                plane_u8(cells + cell_index(width, row, col),
+                         out + p * count + width * row + col, run,
+                         plane_flags[p]);
+            }
+        }
+    }
+    if (g_layout.lazy) {
+        resolve_wall_plane(cells, width, height, out + PLANE_WALL * count,
+                           NULL);
+    }
+    unsigned char* head_plane = out + PLANE_HEAD * count;
+    memset(head_plane, 0, count);
+    // the step that ends a game can leave the head off the board
+    if (head_on_board(head, width, height)) {
+        head_plane[width * head[0] + head[1]] = 1;
+    }
+}
+
+/** Like `encode_planes_u8`, but writes 0.0 and 1.0 floats. */
+void encode_planes_f32(const int* cells, size_t width, size_t height,
+                       snake_t* snake_p, float* out) {
+    size_t count = width * height;
+    int* head = get_first(snake_p->position);
+
+    for (int p = 0; p < PLANE_HEAD; p++) {
+        if (!g_layout.row_offset) {
+            plane_f32(cells, out + p * count, count, plane_flags[p]);
+            continue;
+        }
+        for (size_t row = 0; row < height; row++) {
+            for (size_t col = 0, run; col < width; col += run) {
+                run = contiguous_run(col, width - col);
+                plane_f32(cells + cell_index(width, row, col),
+                          out + p * count + width * row + col, run,
+                          plane_flags[p]);
+            }
+        }
+    }
+    if (g_layout.lazy) {
+        resolve_wall_plane(cells, width, height, NULL,
+                           out + PLANE_WALL * count);
+    }
+    float* head_plane = out + PLANE_HEAD * count;
+    memset(head_plane, 0, count * sizeof(float));
+    // the step that ends a game can leave the head off the board
+    if (head_on_board(head, width, height)) {
+        head_plane[width * head[0] + head[1]] = 1.0f;
+    }
+}
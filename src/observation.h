@@ -0,0 +1,26 @@
+#ifndef OBSERVATION_H
+#define OBSERVATION_H
+
+#include <stddef.h>
+
+#include "common.h"
+
+/** Feature planes written by `encode_planes_u8` and `encode_planes_f32`, in
+ * order. Each plane has one entry per board cell, in the board's row-major
+ * order, set to 1 where the feature is present and 0 elsewhere.
+ */
+enum obs_plane { PLANE_WALL, PLANE_SNAKE, PLANE_FOOD, PLANE_HEAD, PLANE_COUNT };
+
+// Number of entries written by `encode_window_*` for a given radius.
+#define WINDOW_CELLS(radius) ((2 * (radius) + 1) * (2 * (radius) + 1))
+
+void encode_window_u8(const int* cells, size_t width, size_t height,
+                      snake_t* snake_p, size_t radius, unsigned char* out);
+void encode_window_f32(const int* cells, size_t width, size_t height,
+                       snake_t* snake_p, size_t radius, float* out);
+void encode_planes_u8(const int* cells, size_t width, size_t height,
+                      snake_t* snake_p, unsigned char* out);
+void encode_planes_f32(const int* cells, size_t width, size_t height,
+                       snake_t* snake_p, float* out);
+
+#endif
@@ -0,0 +1,161 @@
+#include "packed_body.h"
+
+#include <stdlib.h>
+
+// Links the ring starts out with room for.
+#define INITIAL_LINKS 64
+
+/** Returns link slot `pos` of the ring. */
+static inline int get_link(const uint8_t* bits, size_t pos) {
+    return (bits[pos >> 2] >> ((pos & 3) * 2)) & 3;
+}
+
+/** Stores `dir` in link slot `pos` of the ring. */
+static inline void set_link(uint8_t* bits, size_t pos, int dir) {
+    unsigned shift = (pos & 3) * 2;
+    bits[pos >> 2] = (bits[pos >> 2] & ~(3u << shift)) | (dir << shift);
+}
+
+/** Returns the cell one step from `cell` in direction `dir`, wrapping around
+ * the edges. A body on a walled board never crosses an edge, so there the
+ * wrapping never comes into play.
+ */
+static unsigned step_cell(const packed_body_t* body, unsigned cell, int dir) {
+    size_t width = body->width;
+    size_t row = cell / width;
+    size_t col = cell % width;
+    switch (dir) {
+        case 0: row = row > 0 ? row - 1 : body->height - 1; break;
+        case 1: row = row + 1 < body->height ? row + 1 : 0; break;
+        case 2: col = col > 0 ? col - 1 : width - 1; break;
+        default: col = col + 1 < width ? col + 1 : 0; break;
+    }
+    return width * row + col;
+}
+
+/** Sets up a one-segment body on `cell`. Returns 0 on success and -1 if
+ * memory could not be allocated.
+ * Arguments:
+ *  - body: the body to initialize.
+ *  - width: width of the board.
+ *  - height: height of the board.
+ *  - cell: index of the snake's only cell.
+ */
+int packed_body_init(packed_body_t* body, size_t width, size_t height,
+                     unsigned cell) {
+    body->bits = calloc(INITIAL_LINKS / 4, 1);
+    if (!body->bits) {
+        return -1;
+    }
+    body->capacity = INITIAL_LINKS;
+    body->width = width;
+    body->height = height;
+    packed_body_reset(body, cell);
+    return 0;
+}
+
+/** Frees the body's ring. */
+void packed_body_free(packed_body_t* body) {
+    free(body->bits);
+    body->bits = NULL;
+    body->capacity = 0;
+    body->count = 0;
+}
+
+/** Shrinks the body back to a single segment on `cell`, keeping the ring. */
+void packed_body_reset(packed_body_t* body, unsigned cell) {
+    body->start = 0;
+    body->count = 0;
+    body->head = cell;
+    body->tail = cell;
+}
+
+/** Doubles the ring, unwinding the links to the start of the new one.
+ * Returns 0 on success and -1 if memory could not be allocated.
+ */
+static int grow(packed_body_t* body) {
+    size_t capacity = body->capacity * 2;
+    uint8_t* bits = calloc(capacity / 4, 1);
+    if (!bits) {
+        return -1;
+    }
+    size_t mask = body->capacity - 1;
+    for (size_t i = 0; i < body->count; i++) {
+        set_link(bits, i, get_link(body->bits, (body->start + i) & mask));
+    }
+    free(body->bits);
+    body->bits = bits;
+    body->capacity = capacity;
+    body->start = 0;
+    return 0;
+}
+
+/** Grows the ring until it holds at least `links` links, so that pushes up
+ * to that length never allocate. Returns 0 on success and -1 if memory
+ * could not be allocated.
+ */
+int packed_body_reserve(packed_body_t* body, size_t links) {
+    while (body->capacity < links) {
+        if (grow(body) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/** Moves the head one step in direction `dir`, keeping every other segment
+ * where it is; the body gets one segment longer. Pop the tail as well to
+ * move the whole snake. Returns 0 on success and -1 if memory could not be
+ * allocated. O(1) apart from the occasional doubling of the ring.
+ */
+int packed_body_push_head(packed_body_t* body, int dir) {
+    if (body->count == body->capacity && grow(body) != 0) {
+        return -1;
+    }
+    body->start = (body->start - 1) & (body->capacity - 1);
+    set_link(body->bits, body->start, dir);
+    body->count++;
+    body->head = step_cell(body, body->head, dir);
+    return 0;
+}
+
+/** Takes the tail segment off a body of at least two segments. Returns the
+ * cell the tail left. O(1).
+ */
+unsigned packed_body_pop_tail(packed_body_t* body) {
+    unsigned old_tail = body->tail;
+    size_t last = (body->start + body->count - 1) & (body->capacity - 1);
+    body->tail = step_cell(body, body->tail, get_link(body->bits, last));
+    body->count--;
+    return old_tail;
+}
+
+/** Starts an iteration over the cells of `body`, head first. */
+void packed_body_iter_begin(const packed_body_t* body,
+                            packed_body_iter_t* it) {
+    it->body = body;
+    it->link = 0;
+    it->cell = body->head;
+    it->started = 0;
+}
+
+/** Stores the next cell of the body in `cell_p`. Returns 1 if there was one
+ * and 0 once every segment has been visited.
+ */
+int packed_body_iter_next(packed_body_iter_t* it, unsigned* cell_p) {
+    const packed_body_t* body = it->body;
+    if (!it->started) {
+        it->started = 1;
+        *cell_p = it->cell;
+        return 1;
+    }
+    if (it->link == body->count) {
+        return 0;
+    }
+    size_t pos = (body->start + it->link) & (body->capacity - 1);
+    // walk back along the link: the reverse of a direction flips its low bit
+    it->cell = step_cell(body, it->cell, get_link(body->bits, pos) ^ 1);
+    it->link++;
+    *cell_p = it->cell;
+    return 1;
+}
@@ -0,0 +1,61 @@
+#ifndef PACKED_BODY_H
+#define PACKED_BODY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Packed body struct. A snake's body stored as its head and tail cells plus
+ * one 2-bit direction per link between segments, in a circular bit buffer:
+ * 2 bits per segment instead of a list node and a position block. Link `i`
+ * (0 nearest the head) is the direction segment `i + 1` moves to reach
+ * segment `i`, using the snake's encoding (0 up, 1 down, 2 left, 3 right).
+ * Fields:
+ *  - bits: the ring of links, four to a byte.
+ *  - capacity: number of links the ring holds (a power of two).
+ *  - start: ring position of link 0.
+ *  - count: number of links (one less than the number of segments).
+ *  - head, tail: cell indices (`width * row + col`) of the end segments.
+ *  - width, height: dimensions of the board.
+ */
+typedef struct packed_body {
+    uint8_t* bits;
+    size_t capacity;
+    size_t start;
+    size_t count;
+    unsigned head;
+    unsigned tail;
+    size_t width;
+    size_t height;
+} packed_body_t;
+
+/** Iterator over the cells of a packed body, head first.
+ * Fields:
+ *  - body: the body being walked.
+ *  - link: the next link to follow.
+ *  - cell: the cell the iterator is on.
+ *  - started: 0 until the first cell has been returned.
+ */
+typedef struct packed_body_iter {
+    const packed_body_t* body;
+    size_t link;
+    unsigned cell;
+    int started;
+} packed_body_iter_t;
+
+int packed_body_init(packed_body_t* body, size_t width, size_t height,
+                     unsigned cell);
+void packed_body_free(packed_body_t* body);
+void packed_body_reset(packed_body_t* body, unsigned cell);
+int packed_body_reserve(packed_body_t* body, size_t links);
+int packed_body_push_head(packed_body_t* body, int dir);
+unsigned packed_body_pop_tail(packed_body_t* body);
+void packed_body_iter_begin(const packed_body_t* body,
+                            packed_body_iter_t* it);
+int packed_body_iter_next(packed_body_iter_t* it, unsigned* cell_p);
+
+/** Returns the number of segments in the body. */
+static inline size_t packed_body_length(const packed_body_t* body) {
+    return body->count + 1;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "perf_counters.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static const char* event_names[PERF_EVENTS] = {
+    "cycles", "instrs", "l1d-miss", "llc-miss", "br-miss",
+};
+
+/** Returns the short name of `event`, as used in report headers. */
+const char* perf_event_name(enum perf_event event) {
+    return event_names[event];
+}
+
+#ifdef __linux__
+/** Fills in the type and config perf_event_open(2) takes for `event`. */
+static void describe(enum perf_event event, struct perf_event_attr* attr) {
+    switch (event) {
+        case PERF_CYCLES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_L1D_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_L1D |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_LLC_MISSES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        default:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+}
+#endif
+
+/** Opens a counter group for the calling thread, counting user-space events
+ * only. Events the machine or kernel will not count are left out rather
+ * than failing the group. Returns the number of counters opened, which is 0
+ * where hardware counters are unavailable; the other functions then do
+ * nothing and every value reads 0.
+ */
+int perf_open(perf_counters_t* perf) {
+    memset(perf, 0, sizeof(*perf));
+    perf->leader = -1;
+    int opened = 0;
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        perf->fds[event] = -1;
+        perf->slots[event] = -1;
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        describe(event, &attr);
+        attr.disabled = perf->leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, perf->leader, 0);
+        if (fd < 0) {
+            continue;
+        }
+        if (perf->leader < 0) {
+            perf->leader = fd;
+        }
+        perf->fds[event] = fd;
+        perf->slots[event] = opened++;
+#endif
+    }
+    return opened;
+}
+
+/** Zeroes the group's counts and starts counting. */
+void perf_start(perf_counters_t* perf) {
+#ifdef __linux__
+    if (perf->leader >= 0) {
+        ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+/** Stops counting and stores the counts since `perf_start` in `values`. */
+void perf_stop(perf_counters_t* perf) {
+    memset(perf->values, 0, sizeof(perf->values));
+#ifdef __linux__
+    if (perf->leader < 0) {
+        return;
+    }
+    ioctl(perf->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // {nr, time_enabled, time_running, value[nr]}
+    uint64_t group[3 + PERF_EVENTS];
+    if (read(perf->leader, group, sizeof(group)) < (ssize_t)(3 * 8)) {
+        return;
+    }
+    uint64_t enabled = group[1];
+    uint64_t running = group[2];
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        int slot = perf->slots[event];
+        if (slot < 0 || (uint64_t)slot >= group[0]) {
+            continue;
+        }
+        uint64_t value = group[3 + slot];
+        // a multiplexed group only counted for part of the time
+        if (running > 0 && running < enabled) {
+            value = (uint64_t)((double)value * enabled / running);
+        }
+        perf->values[event] = value;
+    }
+#endif
+}
+
+/** Closes the group's counters. */
+void perf_close(perf_counters_t* perf) {
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        if (perf->fds[event] >= 0) {
+            close(perf->fds[event]);
+            perf->fds[event] = -1;
+        }
+    }
+    perf->leader = -1;
+}
@@ -0,0 +1,41 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/** Hardware events that can be counted around a region of code. */
+enum perf_event {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENTS,
+};
+
+/** Perf counters struct. One group of hardware counters for the calling
+ * thread, opened with perf_event_open(2) and started and stopped together
+ * so their counts cover exactly the same instructions.
+ * Fields:
+ *  - fds: the counter of each event, or -1 if the event could not be
+ *    opened (no PMU, a virtual machine, perf_event_paranoid, ...).
+ *  - leader: the counter the others are grouped under, or -1 if none
+ *    opened.
+ *  - slots: position of each open counter in a group read.
+ *  - values: counts from the last `perf_stop`, scaled up if the kernel had
+ *    to multiplex the group; 0 for counters that are not open.
+ */
+typedef struct perf_counters {
+    int fds[PERF_EVENTS];
+    int leader;
+    int slots[PERF_EVENTS];
+    uint64_t values[PERF_EVENTS];
+} perf_counters_t;
+
+int perf_open(perf_counters_t* perf);
+void perf_start(perf_counters_t* perf);
+void perf_stop(perf_counters_t* perf);
+void perf_close(perf_counters_t* perf);
+const char* perf_event_name(enum perf_event event);
+
+#endif
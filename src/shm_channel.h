@@ -0,0 +1,102 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A shared-memory channel through which another process steps a batch of
+// games (see batch_env.h) with no copies and, while both sides keep up,
+// no system calls.
+//
+// The channel is one file, mapped by both sides: a header page, then the
+// arrays it lists by byte offset, each 64-byte aligned. Game `g`'s board is
+// `width * height` FLAG_* bytes at `boards + g * width * height`, row-major.
+// A step goes:
+//   1. the agent writes one `enum input_key` per game to `actions` and
+//      signals SHM_REQUEST;
+//   2. the engine steps every game in place on `boards`, fills in
+//      `rewards`, `done` and `scores`, and signals SHM_RESPONSE.
+// Signalling bumps the event's sequence number; the waiting side spins on
+// it for a while and then sleeps on it as a futex, and the signalling side
+// only makes the wake-up call if somebody is asleep. A sleeping side wakes
+// up now and then to check that the process signalling its event is still
+// running, so neither side hangs when the other dies. The agent ends the
+// session by setting `closing` and signalling SHM_REQUEST.
+
+#define SHM_MAGIC 0x314b4e53u  // "SNK1"
+#define SHM_VERSION 2
+
+enum shm_event { SHM_REQUEST, SHM_RESPONSE, SHM_EVENTS };
+
+/** A sequence number to wait on, alone on its cache line.
+ * Fields:
+ *  - seq: bumped once per signal.
+ *  - sleepers: number of processes asleep on `seq`.
+ *  - signaller: pid of the process that signals the event, or 0 if it has
+ *    not joined yet: the engine for SHM_RESPONSE, the agent for SHM_REQUEST.
+ */
+typedef struct shm_event_word {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t sleepers;
+    _Atomic uint32_t signaller;
+    char padding[52];
+} shm_event_word_t;
+
+/** Channel header, at the start of the shared file.
+ * Fields:
+ *  - magic: SHM_MAGIC, written last, once the rest of the channel is set up.
+ *  - version: SHM_VERSION.
+ *  - count, width, height: number of games and their board size.
+ *  - closing: set by the agent to end the session.
+ *  - boards: offset of the boards, `count * width * height` bytes.
+ *  - actions: offset of the actions, one byte per game.
+ *  - rewards: offset of the rewards, one int32 per game: the score the game
+ *    gained on the last step.
+ *  - done: offset of the done flags, one byte per game: 1 if the game
+ *    ended on the last step; it starts over on the next one.
+ *  - scores: offset of the scores, one int32 per game.
+ *  - length: size of the whole file.
+ *  - events: the two sequence numbers, indexed by `enum shm_event`.
+ */
+typedef struct shm_header {
+    _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t width;
+    uint32_t height;
+    _Atomic uint32_t closing;
+    uint64_t boards;
+    uint64_t actions;
+    uint64_t rewards;
+    uint64_t done;
+    uint64_t scores;
+    uint64_t length;
+    shm_event_word_t events[SHM_EVENTS] __attribute__((aligned(64)));
+} shm_header_t;
+
+/** Shared-memory channel struct. One side's mapping of a channel.
+ * Fields:
+ *  - header: the mapped file.
+ *  - boards, actions, rewards, done, scores: the arrays in the mapping.
+ *  - seen: the last sequence number waited for on each event.
+ */
+typedef struct shm_channel {
+    shm_header_t* header;
+    unsigned char* boards;
+    unsigned char* actions;
+    int32_t* rewards;
+    unsigned char* done;
+    int32_t* scores;
+    uint32_t seen[SHM_EVENTS];
+} shm_channel_t;
+
+int shm_channel_create(shm_channel_t* ch, const char* path, size_t count,
+                       size_t width, size_t height);
+int shm_channel_open(shm_channel_t* ch, const char* path);
+void shm_channel_ready(shm_channel_t* ch);
+void shm_channel_close(shm_channel_t* ch);
+void shm_channel_signal(shm_channel_t* ch, enum shm_event event);
+int shm_channel_wait(shm_channel_t* ch, enum shm_event event);
+
+#endif
@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batch_env.h"
+#include "bot_plugin.h"
+#include "common.h"
+#include "game.h"
+#include "game_setup.h"
+#include "shm_channel.h"
+
+// Serves a batch of games to another process over a shared-memory channel
+// (see shm_channel.h): the agent writes actions, this steps every game in
+// the shared boards, and the agent reads the boards, rewards and done flags
+// straight from the mapping. Runs until the agent closes the channel or
+// exits.
+//
+// With --bot, a bot plugin (see snake_bot.h) picks every game's move
+// instead and writes it over the agent's actions before each step, so an
+// agent can watch, or record, the bot play.
+
+static void usage(void) {
+    printf(
+        "usage: snake-shm [--games N] [--seed SEED] [--grows 0|1] "
+        "[--board BOARD STRING] [--bot BOT.so] PATH\n");
+}
+
+int main(int argc, char** argv) {
+    long games = 1;
+    unsigned seed = 1;
+    int growing = 1;
+    char* board = NULL;
+    char* bot_path = NULL;
+
+    static struct option options[] = {
+        {"games", required_argument, NULL, 'n'},
+        {"seed", required_argument, NULL, 's'},
+        {"grows", required_argument, NULL, 'g'},
+        {"board", required_argument, NULL, 'b'},
+        {"bot", required_argument, NULL, 'p'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': games = atol(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 10); break;
+            case 'g': growing = atoi(optarg); break;
+            case 'b': board = optarg; break;
+            case 'p': bot_path = optarg; break;
+            default: usage(); return 1;
+        }
+    }
+    if (optind + 1 != argc || games < 1 || (growing != 0 && growing != 1)) {
+        usage();
+        return 1;
+    }
+    const char* path = argv[optind];
+
+    int* cells;
+    size_t width;
+    size_t height;
+    snake_t snake;
+    if (initialize_game(&cells, &width, &height, &snake, board) !=
+        INIT_SUCCESS) {
+        printf("invalid board\n");
+        teardown(cells, &snake);
+        return 1;
+    }
+
+    shm_channel_t ch;
+    if (shm_channel_create(&ch, path, games, width, height) != 0) {
+        printf("could not create channel %s: %s\n", path, strerror(errno));
+        teardown(cells, &snake);
+        return 1;
+    }
+    // the games live in the shared boards, so agents see them in place
+    batch_env_t env;
+    if (batch_env_init(&env, games, cells, width, height, &snake, growing,
+                       seed, ch.boards) != 0) {
+        printf("could not allocate %ld games\n", games);
+        shm_channel_close(&ch);
+        unlink(path);
+        teardown(cells, &snake);
+        return 1;
+    }
+    bot_plugin_t bot = {.handle = NULL, .bot = NULL, .state = NULL};
+    snake_bot_view_t* views = NULL;
+    if (bot_path) {
+        if (bot_plugin_load(&bot, bot_path, width, height) != 0) {
+            printf("could not load bot: %s\n", bot_plugin_error());
+        } else if (!(views = malloc(games * sizeof(snake_bot_view_t)))) {
+            printf("could not allocate %ld games\n", games);
+        }
+        if (!views) {
+            bot_plugin_unload(&bot);
+            batch_env_free(&env);
+            shm_channel_close(&ch);
+            unlink(path);
+            teardown(cells, &snake);
+            return 1;
+        }
+    }
+    for (long g = 0; g < games; g++) {
+        ch.actions[g] = INPUT_NONE;
+        ch.scores[g] = env.scores[g];
+    }
+    shm_channel_ready(&ch);
+
+    int status = 0;
+    for (;;) {
+        if (shm_channel_wait(&ch, SHM_REQUEST) != 0) {
+            printf("the agent exited without closing the channel\n");
+            status = 1;
+            break;
+        }
+        if (atomic_load(&ch.header->closing)) {
+            break;
+        }
+        if (views) {
+            bot_view_batch(views, &env);
+            bot_plugin_decide_batch(&bot, views, games, ch.actions);
+        }
+        step_batch(&env, ch.actions);
+        for (long g = 0; g < games; g++) {
+            // a game that ended last step started over from 0
+            int before = ch.done[g] ? 0 : ch.scores[g];
+            ch.rewards[g] = env.scores[g] - before;
+            ch.done[g] = env.done[g];
+            ch.scores[g] = env.scores[g];
+        }
+        shm_channel_signal(&ch, SHM_RESPONSE);
+    }
+
+    free(views);
+    bot_plugin_unload(&bot);
+    batch_env_free(&env);
+    shm_channel_close(&ch);
+    unlink(path);
+    teardown(cells, &snake);
+    return status;
+}
@@ -2,16 +2,31 @@
 #define _XOPEN_SOURCE_EXTENDED 1
 #include <curses.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "autopilot.h"
+#include "board_alloc.h"
+#include "board_layout.h"
+#include "bot_plugin.h"
+#include "broadcast.h"
+#include "connectivity.h"
+#include "distance_field.h"
+#include "frame.h"
 #include "game.h"
 #include "game_over.h"
 #include "game_setup.h"
+#include "items.h"
+#include "leaderboard.h"
 #include "mbstrings.h"
 #include "render.h"
+#include "rules.h"
+#include "telemetry.h"
+#include "trace.h"
 
 /** Gets the next input from the user, or returns INPUT_NONE if no input is
  * provided quickly enough.
@@ -36,6 +51,41 @@ enum input_key get_input() {
     /* DO NOT MODIFY THIS FUNCTION */
 }
 
+/** Removes every occurrence of the option `flag` from the argument list, so
+ * that the positional arguments keep their usual indices. Returns 1 if the
+ * option was present, 0 otherwise.
+ */
+int take_flag(int* argc_p, char** argv, const char* flag) {
+    int found = 0;
+    int kept = 1;
+    for (int i = 1; i < *argc_p; i++) {
+        if (strcmp(argv[i], flag) == 0) {
+            found = 1;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc_p = kept;
+    return found;
+}
+
+/** Removes the option `flag` and the value following it from the argument
+ * list. Returns the value, or NULL if the option was not given.
+ */
+char* take_option(int* argc_p, char** argv, const char* flag) {
+    char* value = NULL;
+    int kept = 1;
+    for (int i = 1; i < *argc_p; i++) {
+        if (strcmp(argv[i], flag) == 0 && i + 1 < *argc_p) {
+            value = argv[++i];
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc_p = kept;
+    return value;
+}
+
 /** Helper function that procs the GAME OVER screen and final key prompt.
  * `snake_p` is not needed until Part 2!
  */
@@ -73,6 +123,40 @@ int main(int argc, char** argv) {
 
     enum board_init_status status;
 
+    // options may appear anywhere on the command line
+    int use_autopilot = take_flag(&argc, argv, "--autopilot");
+    g_layout.lazy = take_flag(&argc, argv, "--lazy");
+    char* frames_path = take_option(&argc, argv, "--frames");
+    char* broadcast_path = take_option(&argc, argv, "--broadcast");
+    char* scores_path = take_option(&argc, argv, "--scores");
+    char* rules_path = take_option(&argc, argv, "--rules");
+    char* layout_name = take_option(&argc, argv, "--layout");
+    char* trace_path = take_option(&argc, argv, "--trace");
+    char* bot_path = take_option(&argc, argv, "--bot");
+    char* telemetry_path = take_option(&argc, argv, "--telemetry");
+    char* board_threads = take_option(&argc, argv, "--board-threads");
+
+    // the layout has to be chosen before the board is allocated
+    if (layout_name && layout_parse(layout_name, &g_layout.kind) != 0) {
+        printf("unknown layout %s (expected row, tiled or morton)\n",
+               layout_name);
+        return 0;
+    }
+
+    // large boards are first-touched by this many pinned threads
+    if (board_threads) {
+        g_board_threads = strtoul(board_threads, NULL, 10);
+        if (g_board_threads < 1) {
+            printf("--board-threads must be at least 1\n");
+            return 0;
+        }
+    }
+
+    if (trace_path && trace_start(trace_path) != 0) {
+        printf("tracing is not compiled in; rebuild with make -B TRACE=1\n");
+        return 0;
+    }
+
     // initialize board from command line arguments
     switch (argc) {
         case (2):
@@ -100,7 +184,10 @@ int main(int argc, char** argv) {
             break;
         case (1):
         default:
-            printf("usage: snake <GROWS: 0|1> [BOARD STRING]\n");
+            printf("usage: snake [--autopilot] [--frames PATH] [--broadcast SOCKET] "
+                "[--scores PATH] [--rules PATH] [--layout row|tiled|morton] "
+                "[--lazy] [--trace PATH] [--bot PATH] [--telemetry PATH] "
+                "[--board-threads N] <GROWS: 0|1> [BOARD STRING]\n");
             return 0;
     }
 
@@ -111,19 +198,267 @@ int main(int argc, char** argv) {
         return status;
     }
 
+    // everything below is set up in order and, whether the game is played
+    // or setup stops partway, freed in reverse order at `cleanup`
+    int exit_status = 0;
+    items_t items;
+    autopilot_t autopilot;
+    int have_autopilot = 0;
+    bot_plugin_t bot = {.handle = NULL, .bot = NULL, .state = NULL};
+    cell_log_t log = {.indices = NULL, .count = 0, .capacity = 0};
+    connectivity_t regions;
+    int have_regions = 0;
+    distance_field_t distances;
+    int have_distances = 0;
+    telemetry_t telemetry;
+    int have_telemetry = 0;
+    frame_t frame;
+    int have_frame = 0;
+    int frames_fd = -1;
+    broadcast_t broadcast;
+    int have_broadcast = 0;
+    leaderboard_t leaderboard;
+    int have_leaderboard = 0;
+    size_t rank = 0;
+    size_t ranked = 0;
+
+    if (rules_path) {
+        int rules_status = rules_load(&g_rules, rules_path);
+        if (rules_status != 0) {
+            if (rules_status < 0) {
+                printf("could not read rules %s\n", rules_path);
+            } else {
+                printf("%s:%d: invalid rule\n", rules_path, rules_status);
+            }
+            exit_status = 1;
+            goto cleanup;
+        }
+    }
+
     // Read in the player's name & save its name and length
     char name_buffer[1000];
     read_name(name_buffer);
     g_name = name_buffer;
     g_name_len = mbslen(name_buffer);
 
+    // extra foods and power-ups are tracked in an item table
+    if (g_rules.foods > 1 || g_rules.powerup_every > 0) {
+        if (items_init(&items, cells, width, height) != 0) {
+            printf("could not allocate items for a %zux%zu board\n", width,
+                   height);
+            exit_status = 1;
+            goto cleanup;
+        }
+        g_items = &items;
+        while (items.live[ITEM_FOOD] < g_rules.foods) {
+            place_food(cells, width, height);
+        }
+    }
+
+    if (use_autopilot) {
+        if (autopilot_init(&autopilot, width, height) != 0) {
+            printf("could not allocate autopilot for a %zux%zu board\n",
+                   width, height);
+            exit_status = 1;
+            goto cleanup;
+        }
+        have_autopilot = 1;
+    }
+
+    // a bot loaded from a shared object (see snake_bot.h) plays instead
+    if (bot_path && bot_plugin_load(&bot, bot_path, width, height) != 0) {
+        printf("could not load bot: %s\n", bot_plugin_error());
+        exit_status = 1;
+        goto cleanup;
+    }
+
+    // one cell log, owned here, is read by everything that follows the
+    // cells `update` writes: the trackers below and the spectator broadcast
+    if ((use_autopilot || telemetry_path || broadcast_path) &&
+        cell_log_claim(&log) != 0) {
+        printf("the cell log is already claimed\n");
+        exit_status = 1;
+        goto cleanup;
+    }
+
+    // the autopilot sizes open regions and finds food from trackers that
+    // follow the cell log, rather than searching every tick; telemetry
+    // reads food distances from the same tracker
+    if (use_autopilot && connectivity_init(&regions, width, height) == 0) {
+        connectivity_rebuild(&regions, cells);
+        autopilot.regions = &regions;
+        have_regions = 1;
+    }
+    if ((use_autopilot || telemetry_path) &&
+        distance_field_init(&distances, width, height) == 0) {
+        distance_field_rebuild(&distances, cells);
+        have_distances = 1;
+        if (use_autopilot) {
+            autopilot.distances = &distances;
+        }
+    }
+
+    // per-tick metrics, written in column chunks (see telemetry.h)
+    if (telemetry_path) {
+        if (telemetry_open(&telemetry, telemetry_path,
+                           TELEMETRY_CHUNK_ROWS) != 0) {
+            printf("could not open telemetry output %s\n", telemetry_path);
+            exit_status = 1;
+            goto cleanup;
+        }
+        have_telemetry = 1;
+    }
+
+    // headless frames, e.g. to a file or a spectator's terminal
+    if (frames_path) {
+        frames_fd = open(frames_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (frames_fd < 0 || frame_init(&frame, width, height, 1) != 0) {
+            printf("could not open frame output %s\n", frames_path);
+            exit_status = 1;
+            goto cleanup;
+        }
+        have_frame = 1;
+        frame_render(&frame, cells, width, height);
+        frame_write(&frame, frames_fd);
+    }
+
+    // live spectators, sent a keyframe every 50 ticks
+    if (broadcast_path) {
+        if (broadcast_open(&broadcast, broadcast_path, width, height, 50,
+                           &log) != 0) {
+            printf("could not open spectator socket %s\n", broadcast_path);
+            exit_status = 1;
+            goto cleanup;
+        }
+        have_broadcast = 1;
+    }
+
+    // persistent high scores; the log is fsync'd every 16 records and on close
+    if (scores_path) {
+        if (leaderboard_open(&leaderboard, scores_path, 16) != 0) {
+            printf("could not open score log %s\n", scores_path);
+            exit_status = 1;
+            goto cleanup;
+        }
+        have_leaderboard = 1;
+    }
+
     //initialize_window(width, height);
 
+    // ticks fall on a fixed schedule from the monotonic clock, so time spent
+    // updating and rendering does not stretch the interval
+    uint64_t deadline = monotonic_ns();
     while (g_game_over != 1) {
-        usleep(300000);
-        update(cells, width, height, &snake, get_input(), snake_grows);
+        uint64_t interval = rules_tick_ns(&g_rules, g_score);
+        if (g_items && g_items->boost_left > 0) {
+            interval /= 2;
+        }
+        deadline += interval;
+        uint64_t now = monotonic_ns();
+        if (deadline < now) {
+            // fell behind (e.g. suspended): restart the schedule from now
+            // rather than rushing through the missed ticks
+            deadline = now;
+        }
+        sleep_until_ns(deadline);
+        uint64_t tick_start = monotonic_ns();
+        TRACE_BEGIN("tick");
+        enum input_key input;
+        if (bot_path) {
+            snake_bot_view_t view;
+            bot_view_game(&view, cells, width, height, &snake);
+            input = bot_plugin_decide(&bot, &view);
+        } else if (use_autopilot) {
+            input = autopilot_next_input(&autopilot, cells, width, height,
+                                         &snake);
+        } else {
+            input = get_input();
+        }
+        if (input != INPUT_NONE) {
+            TRACE_INSTANT("input", input);
+        }
+        TRACE_BEGIN("update");
+        update(cells, width, height, &snake, input, snake_grows);
+        TRACE_END("update");
+        if (have_regions) {
+            connectivity_apply(&regions, cells, &log);
+        }
+        if (have_distances) {
+            distance_field_apply(&distances, cells, &log);
+        }
         //render_game(cells, width, height);
+        if (have_frame) {
+            frame_render(&frame, cells, width, height);
+            frame_write(&frame, frames_fd);
+        }
+        if (have_broadcast) {
+            broadcast_tick(&broadcast, cells);
+        }
+        if (have_telemetry) {
+            int* head = get_first(snake.position);
+            int64_t to_food = -1;
+            // the step that ends a game can leave the head off the board
+            if (have_distances && head[0] >= 0 && head[1] >= 0 &&
+                (size_t)head[0] < height && (size_t)head[1] < width) {
+                unsigned steps =
+                    distance_from_cell(&distances, width * head[0] + head[1]);
+                to_food = steps == DISTANCE_NONE ? -1 : (int64_t)steps;
+            }
+            telemetry_record(&telemetry, &snake, to_food, g_score,
+                             monotonic_ns() - tick_start);
+        }
+        TRACE_END("tick");
+    }
+
+    if (have_leaderboard &&
+        leaderboard_record(&leaderboard, g_name, g_score) == 0) {
+        rank = leaderboard_rank(&leaderboard, g_score);
+        ranked = leaderboard.count;
+    }
+
+cleanup:
+    if (have_leaderboard) {
+        leaderboard_close(&leaderboard);
+    }
+    if (have_broadcast) {
+        broadcast_close(&broadcast);
+    }
+    if (have_frame) {
+        frame_free(&frame);
+    }
+    if (frames_fd >= 0) {
+        close(frames_fd);
+    }
+    if (have_telemetry && telemetry_close(&telemetry) != 0) {
+        printf("could not write telemetry to %s\n", telemetry_path);
+    }
+    if (have_distances) {
+        distance_field_free(&distances);
+    }
+    if (have_regions) {
+        connectivity_free(&regions);
+    }
+    cell_log_release(&log);
+    free(log.indices);
+    bot_plugin_unload(&bot);
+    if (have_autopilot) {
+        autopilot_free(&autopilot);
+    }
+    if (g_items) {
+        items_free(&items);
+        g_items = NULL;
+    }
+
+    if (exit_status != 0) {
+        teardown(cells, &snake);
+        game_shutdown();
+        return exit_status;
     }
-    
     end_game(cells, width, height, &snake);
+    game_shutdown();
+    if (rank > 0) {
+        printf("%s scored %d: rank %zu of %zu\n", g_name, g_score, rank,
+               ranked);
+    }
+    return 0;
 }
@@ -0,0 +1,88 @@
+#ifndef SNAKE_BOT_H
+#define SNAKE_BOT_H
+
+// The interface between the game and bots loaded as shared objects. This
+// header is all a bot needs: it includes nothing from the engine, and
+// everything in it keeps its layout for a given SNAKE_BOT_ABI_VERSION.
+//
+// A bot exports one function, named by SNAKE_BOT_ENTRY:
+//
+//     const snake_bot_t* snake_bot_entry(void);
+//
+// and is built with `cc -shared -fPIC mybot.c -o mybot.so`. Bots run in the
+// game's process and see its board in place: a view is only valid for the
+// duration of the call it is passed to, and must not be written through.
+
+#include <stddef.h>
+
+#define SNAKE_BOT_ABI_VERSION 1
+#define SNAKE_BOT_ENTRY "snake_bot_entry"
+
+// Cell values returned by `snake_bot_view_t.cell`.
+#define SNAKE_BOT_PLAIN 1
+#define SNAKE_BOT_SNAKE 2
+#define SNAKE_BOT_WALL 4
+#define SNAKE_BOT_FOOD 8
+
+// Moves a bot can return. SNAKE_BOT_NONE keeps the snake's direction, as
+// does reversing once the snake has eaten.
+#define SNAKE_BOT_UP 0
+#define SNAKE_BOT_DOWN 1
+#define SNAKE_BOT_LEFT 2
+#define SNAKE_BOT_RIGHT 3
+#define SNAKE_BOT_NONE 4
+
+/** View struct. A read-only window onto one game.
+ * Fields:
+ *  - width, height: dimensions of the board.
+ *  - head_row, head_col: the snake's head.
+ *  - head_dir: the direction the snake is heading (a SNAKE_BOT_* move).
+ *  - length: number of segments in the snake.
+ *  - score: the game's score.
+ *  - board, body: the game's own board and snake; opaque, read through
+ *    `cell` and `segments`.
+ *  - cell: returns the SNAKE_BOT_* value of the cell at (row, col).
+ *  - segments: writes the cells (`width * row + col`) of up to `max`
+ *    segments, head first, to `out` and returns how many it wrote.
+ */
+typedef struct snake_bot_view {
+    size_t width;
+    size_t height;
+    size_t head_row;
+    size_t head_col;
+    int head_dir;
+    size_t length;
+    int score;
+    const void* board;
+    const void* body;
+    int (*cell)(const struct snake_bot_view* view, size_t row, size_t col);
+    size_t (*segments)(const struct snake_bot_view* view, size_t* out,
+                       size_t max);
+} snake_bot_view_t;
+
+/** Bot struct. What `snake_bot_entry` returns.
+ * Fields:
+ *  - abi_version: SNAKE_BOT_ABI_VERSION as the bot was built.
+ *  - name: the bot's name.
+ *  - create: sets up the bot for boards of the given size and returns its
+ *    state, which is passed back on every call, or NULL on failure. May be
+ *    NULL for bots that keep no state.
+ *  - destroy: frees the state. May be NULL.
+ *  - decide: returns the move for the game in `view`.
+ *  - decide_batch: writes the move for each of `count` games, which share
+ *    one board size, to `moves`. May be NULL, in which case `decide` is
+ *    called for each game.
+ */
+typedef struct snake_bot {
+    unsigned abi_version;
+    const char* name;
+    void* (*create)(size_t width, size_t height);
+    void (*destroy)(void* state);
+    int (*decide)(void* state, const snake_bot_view_t* view);
+    void (*decide_batch)(void* state, const snake_bot_view_t* views,
+                         size_t count, unsigned char* moves);
+} snake_bot_t;
+
+typedef const snake_bot_t* (*snake_bot_entry_fn)(void);
+
+#endif
@@ -0,0 +1,346 @@
+#include "telemetry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "linked_list.h"
+
+// Longest varint, for a 64-bit value.
+#define MAX_VARINT_BYTES 10
+// Room for the encoding byte, a dictionary's entry count and bit width.
+#define MAX_COLUMN_HEADER_BYTES 16
+
+const char* const telemetry_column_names[TELEMETRY_COLUMNS] = {
+    "head_row", "head_col", "length",  "direction",
+    "turned",   "food_distance", "score", "latency_ns",
+};
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t put_varint(unsigned char* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+/** Reads a varint from `in` at `*pos`, which is moved past it. Returns 0 on
+ * success and -1 if it runs past `length`.
+ */
+static int get_varint(const unsigned char* in, size_t length, size_t* pos,
+                      uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= length) {
+            return -1;
+        }
+        unsigned char byte = in[(*pos)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/** Writes all of `length` bytes to `fd`. Returns 0 on success, -1 if not. */
+static int write_all(int fd, const unsigned char* out, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, out, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        out += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/** Opens a telemetry file at `path`, replacing any file there, and writes
+ * its header. Returns 0 on success and -1 on failure.
+ * Arguments:
+ *  - tm: the sink to set up.
+ *  - path: the file to write.
+ *  - chunk_rows: number of ticks buffered before a chunk is written, e.g.
+ *    TELEMETRY_CHUNK_ROWS.
+ */
+int telemetry_open(telemetry_t* tm, const char* path, size_t chunk_rows) {
+    memset(tm, 0, sizeof(*tm));
+    tm->capacity = chunk_rows;
+    tm->last_direction = -1;
+    size_t encoded_bytes =
+        chunk_rows * MAX_VARINT_BYTES + MAX_COLUMN_HEADER_BYTES +
+        TELEMETRY_DICT_MAX * MAX_VARINT_BYTES;
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        tm->columns[c] = malloc(chunk_rows * sizeof(int64_t));
+    }
+    tm->encoded = malloc(encoded_bytes);
+    tm->scratch = malloc(encoded_bytes);
+    tm->fd = -1;
+    int allocated = chunk_rows > 0 && tm->encoded && tm->scratch;
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        allocated = allocated && tm->columns[c];
+    }
+    if (allocated) {
+        tm->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (tm->fd < 0) {
+        telemetry_close(tm);
+        return -1;
+    }
+
+    size_t length = 0;
+    unsigned char* out = tm->encoded;
+    memcpy(out, "SNKT", 4);
+    length += 4;
+    out[length++] = TELEMETRY_VERSION;
+    out[length++] = TELEMETRY_COLUMNS;
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        size_t name_length = strlen(telemetry_column_names[c]) + 1;
+        memcpy(out + length, telemetry_column_names[c], name_length);
+        length += name_length;
+    }
+    if (write_all(tm->fd, out, length) != 0) {
+        telemetry_close(tm);
+        return -1;
+    }
+    return 0;
+}
+
+/** Buffers one tick's metrics, writing out a chunk once the buffer fills.
+ * Arguments:
+ *  - tm: the sink.
+ *  - snake_p: the snake after the tick's update.
+ *  - food_distance: steps from the head to the nearest food, or -1.
+ *  - score: the score after the update.
+ *  - latency_ns: time spent in the tick.
+ */
+void telemetry_record(telemetry_t* tm, const snake_t* snake_p,
+                      int64_t food_distance, int score, uint64_t latency_ns) {
+    int* head = get_first(snake_p->position);
+    size_t row = tm->rows;
+    tm->columns[TELEMETRY_HEAD_ROW][row] = head[0];
+    tm->columns[TELEMETRY_HEAD_COL][row] = head[1];
+    tm->columns[TELEMETRY_LENGTH][row] = snake_p->snake_len;
+    tm->columns[TELEMETRY_DIRECTION][row] = head[2];
+    tm->columns[TELEMETRY_TURNED][row] =
+        tm->last_direction >= 0 && head[2] != tm->last_direction;
+    tm->columns[TELEMETRY_FOOD_DISTANCE][row] = food_distance;
+    tm->columns[TELEMETRY_SCORE][row] = score;
+    tm->columns[TELEMETRY_LATENCY_NS][row] = latency_ns;
+    tm->last_direction = head[2];
+
+    if (++tm->rows == tm->capacity) {
+        telemetry_flush(tm);
+    }
+}
+
+static size_t encode_delta(const int64_t* values, size_t rows,
+                           unsigned char* out) {
+    size_t length = 0;
+    out[length++] = TELEMETRY_DELTA;
+    int64_t previous = 0;
+    for (size_t r = 0; r < rows; r++) {
+        length += put_varint(out + length,
+                             zigzag((int64_t)((uint64_t)values[r] - previous)));
+        previous = values[r];
+    }
+    return length;
+}
+
+/** Dictionary-encodes a column chunk. Returns the encoded length, or 0 if
+ * the chunk has more than TELEMETRY_DICT_MAX distinct values.
+ */
+static size_t encode_dict(const int64_t* values, size_t rows,
+                          unsigned char* out) {
+    int64_t entries[TELEMETRY_DICT_MAX];
+    size_t count = 0;
+    // the bits per index depend on the entry count, so the entries are
+    // gathered before any index is packed
+    for (size_t r = 0; r < rows; r++) {
+        size_t e = 0;
+        while (e < count && entries[e] != values[r]) {
+            e++;
+        }
+        if (e == count) {
+            if (count == TELEMETRY_DICT_MAX) {
+                return 0;
+            }
+            entries[count++] = values[r];
+        }
+    }
+    int bits = 0;
+    while (((size_t)1 << bits) < count) {
+        bits++;
+    }
+
+    size_t length = 0;
+    out[length++] = TELEMETRY_DICT;
+    length += put_varint(out + length, count);
+    for (size_t e = 0; e < count; e++) {
+        length += put_varint(out + length, zigzag(entries[e]));
+    }
+    out[length++] = bits;
+    uint64_t pending = 0;
+    int pending_bits = 0;
+    for (size_t r = 0; r < rows && bits > 0; r++) {
+        uint64_t index = 0;
+        while (entries[index] != values[r]) {
+            index++;
+        }
+        pending |= index << pending_bits;
+        pending_bits += bits;
+        while (pending_bits >= 8) {
+            out[length++] = pending;
+            pending >>= 8;
+            pending_bits -= 8;
+        }
+    }
+    if (pending_bits > 0) {
+        out[length++] = pending;
+    }
+    return length;
+}
+
+/** Writes the buffered ticks out as a chunk. Returns 0 on success and -1
+ * if this or an earlier write failed.
+ */
+int telemetry_flush(telemetry_t* tm) {
+    size_t rows = tm->rows;
+    tm->rows = 0;
+    if (rows == 0 || tm->failed) {
+        return tm->failed ? -1 : 0;
+    }
+    unsigned char prefix[MAX_VARINT_BYTES];
+    size_t prefix_length = put_varint(prefix, rows);
+    if (write_all(tm->fd, prefix, prefix_length) != 0) {
+        tm->failed = 1;
+        return -1;
+    }
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        size_t length = encode_delta(tm->columns[c], rows, tm->encoded);
+        size_t dict_length = encode_dict(tm->columns[c], rows, tm->scratch);
+        unsigned char* out = tm->encoded;
+        if (dict_length > 0 && dict_length < length) {
+            out = tm->scratch;
+            length = dict_length;
+        }
+        prefix_length = put_varint(prefix, length);
+        if (write_all(tm->fd, prefix, prefix_length) != 0 ||
+            write_all(tm->fd, out, length) != 0) {
+            tm->failed = 1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/** Writes any buffered ticks, closes the file and frees the buffers.
+ * Returns 0 if everything was written and -1 if not.
+ */
+int telemetry_close(telemetry_t* tm) {
+    int status = 0;
+    if (tm->fd >= 0) {
+        status = telemetry_flush(tm);
+        if (close(tm->fd) != 0) {
+            status = -1;
+        }
+        tm->fd = -1;
+    }
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        free(tm->columns[c]);
+        tm->columns[c] = NULL;
+    }
+    free(tm->encoded);
+    free(tm->scratch);
+    tm->encoded = NULL;
+    tm->scratch = NULL;
+    return status;
+}
+
+/** Decodes one column chunk of `rows` values into `values`, for readers of
+ * telemetry files. Returns 0 on success and -1 if the bytes are not a
+ * valid column of that many rows.
+ * Arguments:
+ *  - in: the encoded column, starting with its encoding byte.
+ *  - length: number of bytes in `in`.
+ *  - rows: the chunk's row count.
+ *  - values: where to put the `rows` values.
+ */
+int telemetry_decode_column(const unsigned char* in, size_t length,
+                            size_t rows, int64_t* values) {
+    size_t pos = 0;
+    uint64_t value;
+    if (length == 0) {
+        return -1;
+    }
+    enum telemetry_encoding encoding = in[pos++];
+
+    if (encoding == TELEMETRY_DELTA) {
+        int64_t previous = 0;
+        for (size_t r = 0; r < rows; r++) {
+            if (get_varint(in, length, &pos, &value) != 0) {
+                return -1;
+            }
+            previous = (int64_t)((uint64_t)previous + unzigzag(value));
+            values[r] = previous;
+        }
+        return pos == length ? 0 : -1;
+    }
+    if (encoding != TELEMETRY_DICT) {
+        return -1;
+    }
+
+    uint64_t count;
+    int64_t entries[TELEMETRY_DICT_MAX];
+    if (get_varint(in, length, &pos, &count) != 0 || count == 0 ||
+        count > TELEMETRY_DICT_MAX) {
+        return -1;
+    }
+    for (uint64_t e = 0; e < count; e++) {
+        if (get_varint(in, length, &pos, &value) != 0) {
+            return -1;
+        }
+        entries[e] = unzigzag(value);
+    }
+    if (pos >= length) {
+        return -1;
+    }
+    int bits = in[pos++];
+    if (bits > 4 || ((uint64_t)1 << bits) < count ||
+        length - pos != (rows * bits + 7) / 8) {
+        return -1;
+    }
+    uint64_t pending = 0;
+    int pending_bits = 0;
+    for (size_t r = 0; r < rows; r++) {
+        while (pending_bits < bits) {
+            pending |= (uint64_t)in[pos++] << pending_bits;
+            pending_bits += 8;
+        }
+        uint64_t index = pending & (((uint64_t)1 << bits) - 1);
+        pending >>= bits;
+        pending_bits -= bits;
+        if (index >= count) {
+            return -1;
+        }
+        values[r] = entries[index];
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// Per-tick game metrics, buffered a chunk of ticks at a time and written as
+// one column per metric, so that a reader can skip straight to the columns
+// it needs.
+//
+// A telemetry file is:
+//   - "SNKT", a version byte (TELEMETRY_VERSION) and a column count byte,
+//     then each column's name, NUL-terminated;
+//   - chunks to the end of the file. A chunk is a varint row count, then
+//     for each column a varint byte length and that many bytes of encoded
+//     column, which start with an `enum telemetry_encoding` byte.
+// Varints are LEB128; signed values are zigzag encoded first. Each column
+// chunk is encoded whichever way comes out smaller:
+//   - TELEMETRY_DELTA: the first value, then the difference from each value
+//     to the next.
+//   - TELEMETRY_DICT: a varint entry count, the entries, a byte holding the
+//     bits per index, then one index per row into the entries, packed
+//     least-significant bit first. Only columns with at most
+//     TELEMETRY_DICT_MAX distinct values in the chunk are tried.
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_CHUNK_ROWS 16384
+#define TELEMETRY_DICT_MAX 16
+
+enum telemetry_column {
+    TELEMETRY_HEAD_ROW,
+    TELEMETRY_HEAD_COL,
+    TELEMETRY_LENGTH,
+    TELEMETRY_DIRECTION,
+    TELEMETRY_TURNED,        // 1 if the snake changed direction this tick
+    TELEMETRY_FOOD_DISTANCE, // steps to the nearest food, or -1
+    TELEMETRY_SCORE,
+    TELEMETRY_LATENCY_NS,    // time spent in the tick, not counting sleep
+    TELEMETRY_COLUMNS
+};
+
+enum telemetry_encoding { TELEMETRY_DELTA, TELEMETRY_DICT };
+
+/** Telemetry struct. A sink for per-tick metrics.
+ * Fields:
+ *  - fd: the telemetry file.
+ *  - capacity: number of rows in a chunk.
+ *  - rows: number of rows buffered.
+ *  - columns: the buffered rows, one array of `capacity` values per column.
+ *  - encoded, scratch: room for one encoded column chunk each; the two
+ *    encodings are tried side by side.
+ *  - last_direction: the head's direction at the previous tick, or -1.
+ *  - failed: 1 once a write has failed; later chunks are dropped.
+ */
+typedef struct telemetry {
+    int fd;
+    size_t capacity;
+    size_t rows;
+    int64_t* columns[TELEMETRY_COLUMNS];
+    unsigned char* encoded;
+    unsigned char* scratch;
+    int last_direction;
+    int failed;
+} telemetry_t;
+
+extern const char* const telemetry_column_names[TELEMETRY_COLUMNS];
+
+int telemetry_open(telemetry_t* tm, const char* path, size_t chunk_rows);
+void telemetry_record(telemetry_t* tm, const snake_t* snake_p,
+                      int64_t food_distance, int score, uint64_t latency_ns);
+int telemetry_flush(telemetry_t* tm);
+int telemetry_close(telemetry_t* tm);
+int telemetry_decode_column(const unsigned char* in, size_t length,
+                            size_t rows, int64_t* values);
+
+#endif
@@ -0,0 +1,139 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+/** Initializes an empty wheel whose clock reads `now`. */
+void timer_wheel_init(timer_wheel_t* tw, uint64_t now) {
+    tw->now = now;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            wheel_timer_t* sentinel = &tw->slots[level][slot];
+            sentinel->next = sentinel;
+            sentinel->prev = sentinel;
+        }
+    }
+}
+
+/** Links the timer into the slot for its expiry time. */
+static void place(timer_wheel_t* tw, wheel_timer_t* timer) {
+    // The first group of bits in which the expiry differs from the current
+    // time picks the level: the slot is then always ahead of the wheel's
+    // position on that level, and gets cascaded down before it is due.
+    uint64_t diff = timer->expires ^ tw->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && diff >= (1ull << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    size_t slot;
+    if (diff >> (WHEEL_BITS * WHEEL_LEVELS)) {
+        // beyond the wheel's range: park it in the last slot of the top
+        // level to be placed again once that comes round
+        slot = ((tw->now >> (WHEEL_BITS * level)) + SLOT_MASK) & SLOT_MASK;
+    } else {
+        slot = (timer->expires >> (WHEEL_BITS * level)) & SLOT_MASK;
+    }
+
+    wheel_timer_t* sentinel = &tw->slots[level][slot];
+    timer->next = sentinel;
+    timer->prev = sentinel->prev;
+    sentinel->prev->next = timer;
+    sentinel->prev = timer;
+}
+
+/** Schedules the timer to become due at wheel tick `expires`. A timer that is
+ * already due becomes due at the next tick. Rescheduling a pending timer
+ * moves it.
+ * Arguments:
+ *  - tw: the wheel.
+ *  - timer: the timer to schedule.
+ *  - expires: the tick at which it is due.
+ */
+void timer_wheel_add(timer_wheel_t* tw, wheel_timer_t* timer,
+                     uint64_t expires) {
+    if (timer->pending) {
+        timer_wheel_cancel(tw, timer);
+    }
+    timer->expires = expires > tw->now ? expires : tw->now + 1;
+    timer->pending = 1;
+    place(tw, timer);
+}
+
+/** Unschedules the timer; does nothing if it is not pending. */
+void timer_wheel_cancel(timer_wheel_t* tw, wheel_timer_t* timer) {
+    if (!timer->pending) {
+        return;
+    }
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->pending = 0;
+}
+
+/** Moves every timer of one slot into the finer levels. */
+static void cascade(timer_wheel_t* tw, int level, size_t slot) {
+    wheel_timer_t* sentinel = &tw->slots[level][slot];
+    wheel_timer_t* timer = sentinel->next;
+
+    sentinel->next = sentinel;
+    sentinel->prev = sentinel;
+    while (timer != sentinel) {
+        wheel_timer_t* next = timer->next;
+        place(tw, timer);
+        timer = next;
+    }
+}
+
+/** Advances the wheel's clock to `now` and returns every timer that became
+ * due, as a NULL-terminated list linked through `next`, in expiry order.
+ * The returned timers are no longer pending; a callback may reschedule the
+ * timer it is handed, but must read `next` first.
+ * Arguments:
+ *  - tw: the wheel.
+ *  - now: the current tick. Going backwards is ignored.
+ */
+wheel_timer_t* timer_wheel_advance(timer_wheel_t* tw, uint64_t now) {
+    wheel_timer_t* due = NULL;
+    wheel_timer_t** due_tail = &due;
+
+    while (tw->now < now) {
+        tw->now++;
+
+        // When the finest level wraps, pull the next slot of each coarser
+        // level that wrapped too, coarsest first so that timers it hands
+        // down are picked up by the finer cascades.
+        if ((tw->now & SLOT_MASK) == 0) {
+            int top = 1;
+            while (top < WHEEL_LEVELS - 1 &&
+                   ((tw->now >> (WHEEL_BITS * top)) & SLOT_MASK) == 0) {
+                top++;
+            }
+            for (int level = top; level >= 1; level--) {
+                cascade(tw, level,
+                        (tw->now >> (WHEEL_BITS * level)) & SLOT_MASK);
+            }
+        }
+
+        wheel_timer_t* sentinel = &tw->slots[0][tw->now & SLOT_MASK];
+        wheel_timer_t* timer = sentinel->next;
+        while (timer != sentinel) {
+            wheel_timer_t* next = timer->next;
+            if (timer->expires <= tw->now) {
+                timer->pending = 0;
+                timer->prev = NULL;
+                *due_tail = timer;
+                due_tail = &timer->next;
+            } else {
+                // parked beyond the wheel's range: place it again
+                place(tw, timer);
+            }
+            timer = next;
+        }
+        sentinel->next = sentinel;
+        sentinel->prev = sentinel;
+    }
+
+    *due_tail = NULL;
+    return due;
+}
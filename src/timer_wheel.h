@@ -0,0 +1,46 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots; level n holds
+// timers due within WHEEL_SLOTS^(n + 1) ticks.
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+/** Wheel timer struct. Embedded in whatever is being scheduled, so that
+ * adding and cancelling never allocate.
+ * Fields:
+ *  - expires: wheel tick at which the timer is due.
+ *  - next, prev: neighbors in the slot (or due list) the timer is in.
+ *  - pending: 1 while the timer is scheduled.
+ */
+typedef struct wheel_timer {
+    uint64_t expires;
+    struct wheel_timer* next;
+    struct wheel_timer* prev;
+    int pending;
+} wheel_timer_t;
+
+/** Timer wheel struct. A hierarchical timing wheel: scheduling and
+ * cancelling are O(1), and timers far in the future are moved to finer
+ * levels only as their time approaches.
+ * Fields:
+ *  - now: the last tick the wheel was advanced to.
+ *  - slots: the circular list of timers in each slot of each level; each
+ *    entry is the list's sentinel.
+ */
+typedef struct timer_wheel {
+    uint64_t now;
+    wheel_timer_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t* tw, uint64_t now);
+void timer_wheel_add(timer_wheel_t* tw, wheel_timer_t* timer,
+                     uint64_t expires);
+void timer_wheel_cancel(timer_wheel_t* tw, wheel_timer_t* timer);
+wheel_timer_t* timer_wheel_advance(timer_wheel_t* tw, uint64_t now);
+
+#endif
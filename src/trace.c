@@ -0,0 +1,233 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rules.h"
+
+/** One recorded event.
+ * Fields:
+ *  - ns: monotonic time of the event, in nanoseconds.
+ *  - name: the string literal passed to the macro.
+ *  - value: the value of an instant event.
+ *  - phase: 'B', 'E' or 'i', as in the Chrome trace format.
+ */
+struct trace_record {
+    uint64_t ns;
+    const char* name;
+    long value;
+    char phase;
+};
+
+/** A thread's ring of events. Only its own thread writes it; `count` is the
+ * number of events ever recorded, published after each record is written so
+ * a dump sees whole records.
+ */
+struct trace_ring {
+    struct trace_ring* next;
+    unsigned tid;
+    _Atomic size_t count;
+    struct trace_record records[TRACE_RING_EVENTS];
+};
+
+// every ring ever created, newest first; rings live until exit
+static struct trace_ring* _Atomic rings;
+static atomic_uint ring_count;
+static _Thread_local struct trace_ring* my_ring;
+
+static const char* trace_path;
+static const int dump_signals[] = {SIGUSR1, SIGINT, SIGTERM};
+static struct sigaction previous[sizeof(dump_signals) / sizeof(int)];
+
+/** Returns the calling thread's ring, creating and registering it on first
+ * use, or NULL if it could not be allocated.
+ */
+static struct trace_ring* thread_ring(void) {
+    if (my_ring) {
+        return my_ring;
+    }
+    struct trace_ring* ring = malloc(sizeof(*ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->tid = atomic_fetch_add(&ring_count, 1) + 1;
+    atomic_init(&ring->count, 0);
+    ring->next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring->next, ring)) {
+    }
+    my_ring = ring;
+    return ring;
+}
+
+/** Records an event on the calling thread's ring, overwriting its oldest
+ * event once the ring is full. Use the TRACE_* macros rather than calling
+ * this directly.
+ */
+void trace_event(const char* name, char phase, long value) {
+    struct trace_ring* ring = thread_ring();
+    if (!ring) {
+        return;
+    }
+    size_t count = atomic_load_explicit(&ring->count, memory_order_relaxed);
+    struct trace_record* record = &ring->records[count % TRACE_RING_EVENTS];
+    record->ns = monotonic_ns();
+    record->name = name;
+    record->value = value;
+    record->phase = phase;
+    atomic_store_explicit(&ring->count, count + 1, memory_order_release);
+}
+
+/** Output buffer for the dump. It is filled and flushed with plain write(2)
+ * so that the dump can run inside a signal handler.
+ */
+struct out {
+    int fd;
+    size_t len;
+    char bytes[4096];
+};
+
+static void out_flush(struct out* out) {
+    size_t done = 0;
+    while (done < out->len) {
+        ssize_t n = write(out->fd, out->bytes + done, out->len - done);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    out->len = 0;
+}
+
+static void out_str(struct out* out, const char* s) {
+    for (; *s; s++) {
+        if (out->len == sizeof(out->bytes)) {
+            out_flush(out);
+        }
+        out->bytes[out->len++] = *s;
+    }
+}
+
+/** Writes `n` in decimal, zero-padded to at least `digits` digits. */
+static void out_num(struct out* out, long n, int digits) {
+    char buf[24];
+    int i = sizeof(buf);
+    buf[--i] = '\0';
+    unsigned long u = n < 0 ? -(unsigned long)n : (unsigned long)n;
+    do {
+        buf[--i] = '0' + u % 10;
+        u /= 10;
+        digits--;
+    } while (u > 0 || digits > 0);
+    if (n < 0) {
+        buf[--i] = '-';
+    }
+    out_str(out, buf + i);
+}
+
+static void out_record(struct out* out, const struct trace_record* record,
+                       unsigned tid, int first) {
+    char phase[2] = {record->phase, '\0'};
+    out_str(out, first ? "\n" : ",\n");
+    out_str(out, "{\"name\":\"");
+    out_str(out, record->name);
+    out_str(out, "\",\"ph\":\"");
+    out_str(out, phase);
+    // timestamps are in microseconds
+    out_str(out, "\",\"ts\":");
+    out_num(out, record->ns / 1000, 1);
+    out_str(out, ".");
+    out_num(out, record->ns % 1000, 3);
+    out_str(out, ",\"pid\":");
+    out_num(out, getpid(), 1);
+    out_str(out, ",\"tid\":");
+    out_num(out, tid, 1);
+    if (record->phase == 'i') {
+        out_str(out, ",\"s\":\"t\",\"args\":{\"value\":");
+        out_num(out, record->value, 1);
+        out_str(out, "}");
+    }
+    out_str(out, "}");
+}
+
+/** Writes every ring to the path given to `trace_start`, replacing the file.
+ * Each ring holds its thread's last TRACE_RING_EVENTS events; a span whose
+ * start was overwritten shows up as an unmatched end. Safe to call from a
+ * signal handler. Returns 0 on success and -1 if tracing was not started or
+ * the file could not be opened.
+ */
+int trace_dump(void) {
+    if (!trace_path) {
+        return -1;
+    }
+    struct out out;
+    out.fd = open(trace_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out.fd < 0) {
+        return -1;
+    }
+    out.len = 0;
+    out_str(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    int first = 1;
+    for (struct trace_ring* ring = atomic_load(&rings); ring;
+         ring = ring->next) {
+        size_t count = atomic_load_explicit(&ring->count, memory_order_acquire);
+        size_t begin = count > TRACE_RING_EVENTS ? count - TRACE_RING_EVENTS : 0;
+        for (size_t i = begin; i < count; i++) {
+            out_record(&out, &ring->records[i % TRACE_RING_EVENTS], ring->tid,
+                       first);
+            first = 0;
+        }
+    }
+    out_str(&out, "\n]}\n");
+    out_flush(&out);
+    close(out.fd);
+    return 0;
+}
+
+static void dump_at_exit(void) {
+    trace_dump();
+}
+
+/** Dumps the trace, then for anything but SIGUSR1 hands the signal on to
+ * whatever handled it before, so the program still stops.
+ */
+static void dump_on_signal(int sig) {
+    int saved_errno = errno;
+    trace_dump();
+    if (sig != SIGUSR1) {
+        for (size_t i = 0; i < sizeof(dump_signals) / sizeof(int); i++) {
+            if (dump_signals[i] == sig) {
+                sigaction(sig, &previous[i], NULL);
+            }
+        }
+        raise(sig);
+    }
+    errno = saved_errno;
+}
+
+/** Starts writing the trace to `path`: at exit, on SIGINT or SIGTERM, and
+ * (without stopping) on every SIGUSR1. `path` must stay valid until exit.
+ * Returns 0 on success and -1 if the program was built without TRACE=1.
+ */
+int trace_start(const char* path) {
+#ifndef ENABLE_TRACE
+    return -1;
+#endif
+    trace_path = path;
+    atexit(dump_at_exit);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = dump_on_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    for (size_t i = 0; i < sizeof(dump_signals) / sizeof(int); i++) {
+        sigaction(dump_signals[i], &action, &previous[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Event tracing for looking inside a single slow frame. Build with
+// `make -B TRACE=1` to enable it; otherwise the TRACE_* macros expand to
+// nothing and cost nothing.
+//
+// Each thread records into its own ring of the last TRACE_RING_EVENTS
+// events, so emitting an event takes no lock and never blocks. The rings
+// are written out as Chrome trace JSON, which chrome://tracing and
+// ui.perfetto.dev both open.
+
+#define TRACE_RING_EVENTS 65536
+
+#ifdef ENABLE_TRACE
+// TRACE_BEGIN and TRACE_END bracket a span; `name` must be a string literal
+// (only the pointer is stored). TRACE_INSTANT marks a point with a value.
+#define TRACE_BEGIN(name) trace_event(name, 'B', 0)
+#define TRACE_END(name) trace_event(name, 'E', 0)
+#define TRACE_INSTANT(name, value) trace_event(name, 'i', (long)(value))
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name, value) ((void)0)
+#endif
+
+void trace_event(const char* name, char phase, long value);
+int trace_start(const char* path);
+int trace_dump(void);
+
+#endif
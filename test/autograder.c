@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <wchar.h>
 
+#include "../src/board_layout.h"
 #include "../src/common.h"
 #include "../src/game.h"
 #include "../src/game_setup.h"
@@ -41,7 +42,7 @@ void print_game(int* cells, size_t height, size_t width) {
     setlocale(LC_CTYPE, "");
     for (size_t i = 0; i < height; i++) {
         for (size_t j = 0; j < width; j++) {
-            char cell = cells[i * width + j];
+            char cell = cell_flag(cells, width, i, j);
             if (cell == FLAG_PLAIN_CELL) {
                 printf(".");
             } else if (cell == FLAG_SNAKE) {
@@ -113,6 +114,15 @@ int main(int argc, char **argv) {
     FILE *pipe = fdopen(atoi(argv[6]), "w");
 
     set_seed(seed);
+    // SNAKE_LAYOUT=tiled|morton replays the trace on another cell layout
+    char *layout_name = getenv("SNAKE_LAYOUT");
+    if (layout_name && layout_parse(layout_name, &g_layout.kind) != 0) {
+        fprintf(stderr, "Unknown layout %s\n", layout_name);
+        exit(EXIT_FAILURE);
+    }
+    // SNAKE_LAZY=1 replays it on a lazily initialized board
+    char *lazy = getenv("SNAKE_LAZY");
+    g_layout.lazy = lazy && strcmp(lazy, "1") == 0;
     // if no board string is provided then use the default board by setting
     // null
     if (board_string[0] == '0') {
@@ -156,7 +166,7 @@ int main(int argc, char **argv) {
     }
     for (size_t i = 0; i < height; i++) {
         for (size_t j = 0; j < width; j++) {
-            char cell = cells[i * width + j];
+            char cell = cell_flag(cells, width, i, j);
             char cell_as_char;
             if (cell == FLAG_PLAIN_CELL) {
                 cell_as_char = '.';
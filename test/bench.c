@@ -0,0 +1,291 @@
+// Benchmarks board access patterns under each cell layout.
+//
+// Usage: bench [-p] [SIDE [THREADS]]
+// Builds a SIDE x SIDE walled board (default 2048) in each layout, with its
+// pages first-touched by THREADS pinned threads (default 1), and times
+// a column-by-column scan, a flood fill, observation windows, headless
+// frame renders and `update` steps of a snake sweeping the board
+// vertically. With -p, hardware counters (see src/perf_counters.h) are read
+// around each of these and reported per operation as well. Build with
+// `make bench` (ASAN=0 for meaningful numbers).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/board_alloc.h"
+#include "../src/board_layout.h"
+#include "../src/common.h"
+#include "../src/frame.h"
+#include "../src/game.h"
+#include "../src/linked_list.h"
+#include "../src/observation.h"
+#include "../src/perf_counters.h"
+
+#define WINDOW_RADIUS 15
+#define WINDOWS 20000
+#define SNAKE_LEN 256
+#define UPDATE_STEPS 200000
+#define RENDER_FRAMES 4
+
+enum region { COLUMNS, FLOOD, WINDOWS_REGION, RENDER, UPDATE, REGIONS };
+
+// counters read around each region when run with -p
+static perf_counters_t s_perf;
+static int s_counting;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Starts timing (and counting) a region.
+static double region_start(void) {
+    if (s_counting) {
+        perf_start(&s_perf);
+    }
+    return now_ns();
+}
+
+// Ends a region of `ops` operations that started at `start`. Returns the
+// time per operation and stores the counts per operation in `counts`.
+static double region_end(double start, double ops, double* counts) {
+    double elapsed = now_ns() - start;
+    if (s_counting) {
+        perf_stop(&s_perf);
+        for (int event = 0; event < PERF_EVENTS; event++) {
+            counts[event] = s_perf.values[event] / ops;
+        }
+    }
+    return elapsed / ops;
+}
+
+// Builds a walled board in the current layout.
+static int* make_board(size_t side) {
+    int* cells = board_alloc(layout_init(&g_layout, side, side) * sizeof(int));
+    if (!cells) {
+        return NULL;
+    }
+    for (size_t row = 0; row < side; row++) {
+        for (size_t col = 0; col < side; col++) {
+            int edge = row == 0 || col == 0 || row == side - 1 ||
+                       col == side - 1;
+            cells[cell_index(side, row, col)] =
+                edge ? FLAG_WALL : FLAG_PLAIN_CELL;
+        }
+    }
+    return cells;
+}
+
+// Sums the board column by column, the worst case for row-major.
+static double bench_columns(const int* cells, size_t side, long* sink,
+                            double* counts) {
+    double start = region_start();
+    long sum = 0;
+    for (size_t col = 0; col < side; col++) {
+        for (size_t row = 0; row < side; row++) {
+            sum += cell_flag(cells, side, row, col);
+        }
+    }
+    *sink += sum;
+    return region_end(start, (double)side * side, counts);
+}
+
+// Flood-fills the open cells from the center, breadth first.
+static double bench_flood(const int* cells, size_t side, long* sink,
+                          double* counts) {
+    size_t count = side * side;
+    unsigned char* seen = calloc(count, 1);
+    unsigned* queue = malloc(count * sizeof(unsigned));
+    if (!seen || !queue) {
+        free(seen);
+        free(queue);
+        return 0;
+    }
+
+    double start = region_start();
+    size_t head = 0, tail = 0;
+    unsigned center = side * (side / 2) + side / 2;
+    queue[tail++] = center;
+    seen[center] = 1;
+    while (head < tail) {
+        unsigned current = queue[head++];
+        size_t row = current / side;
+        size_t col = current % side;
+        size_t next[4][2] = {
+            {row - 1, col}, {row + 1, col}, {row, col - 1}, {row, col + 1}};
+        for (int dir = 0; dir < 4; dir++) {
+            size_t index = side * next[dir][0] + next[dir][1];
+            if (!seen[index] &&
+                cell_flag(cells, side, next[dir][0], next[dir][1]) ==
+                    FLAG_PLAIN_CELL) {
+                seen[index] = 1;
+                queue[tail++] = index;
+            }
+        }
+    }
+    double elapsed = region_end(start, tail, counts);
+    *sink += tail;
+    free(seen);
+    free(queue);
+    return elapsed;
+}
+
+// Encodes observation windows around random heads.
+static double bench_windows(const int* cells, size_t side, long* sink,
+                            double* counts) {
+    unsigned char window[WINDOW_CELLS(WINDOW_RADIUS)];
+    snake_t snake = {.position = NULL};
+    int position[3] = {0, 0, 0};
+    insert_first(&snake.position, position, sizeof(position));
+    int* head = get_first(snake.position);
+
+    srand(1);
+    double start = region_start();
+    for (int i = 0; i < WINDOWS; i++) {
+        head[0] = rand() % side;
+        head[1] = rand() % side;
+        encode_window_u8(cells, side, side, &snake, WINDOW_RADIUS, window);
+        *sink += window[WINDOW_CELLS(WINDOW_RADIUS) / 2];
+    }
+    double elapsed = region_end(
+        start, (double)WINDOWS * WINDOW_CELLS(WINDOW_RADIUS), counts);
+    free(remove_first(&snake.position));
+    return elapsed;
+}
+
+// Draws the board into a headless frame, the way `render_game` walks it.
+static double bench_render(const int* cells, size_t side, long* sink,
+                           double* counts) {
+    frame_t frame;
+    if (frame_init(&frame, side, side, 1) != 0) {
+        return 0;
+    }
+    double start = region_start();
+    for (int i = 0; i < RENDER_FRAMES; i++) {
+        frame_render(&frame, cells, side, side);
+        *sink += frame.length;
+    }
+    double elapsed =
+        region_end(start, (double)RENDER_FRAMES * side * side, counts);
+    frame_free(&frame);
+    return elapsed;
+}
+
+// Steps a snake up and down the columns of the board with `update`, for
+// about UPDATE_STEPS steps.
+static double bench_update(int* cells, size_t side, long* sink,
+                           double* counts) {
+    snake_t snake = {.position = NULL, .snake_len = 0, .growth_pending = 0};
+    for (int i = 0; i < SNAKE_LEN; i++) {
+        int position[3] = {SNAKE_LEN - i, 1, INPUT_DOWN};
+        insert_last(&snake.position, position, sizeof(position));
+        cells[cell_index(side, SNAKE_LEN - i, 1)] = FLAG_SNAKE;
+        snake.snake_len++;
+    }
+    g_game_over = 0;
+    g_score = 0;
+
+    // sweep: down a column, one step right, up the next, one step right...
+    size_t steps = 0;
+    double start = region_start();
+    for (size_t col = 1;
+         col + 1 < side && steps < UPDATE_STEPS && !g_game_over; col++) {
+        int* head = get_first(snake.position);
+        int down = (size_t)head[0] < side / 2;
+        size_t last_row = down ? side - 2 : 1;
+        while ((size_t)head[0] != last_row && !g_game_over) {
+            update(cells, side, side, &snake, down ? INPUT_DOWN : INPUT_UP, 0);
+            steps++;
+        }
+        update(cells, side, side, &snake, INPUT_RIGHT, 0);
+        steps++;
+    }
+    double elapsed = region_end(start, steps, counts);
+    *sink += steps;
+
+    int* data = remove_first(&snake.position);
+    while (data) {
+        free(data);
+        data = remove_first(&snake.position);
+    }
+    return elapsed;
+}
+
+// Prints each region's counts per operation, "-" for counters that are
+// not open.
+static void print_counts(double counts[REGIONS][PERF_EVENTS]) {
+    static const char* regions[] = {"columns", "flood", "windows", "render",
+                                    "update"};
+    for (int region = 0; region < REGIONS; region++) {
+        printf("  %-8s", regions[region]);
+        for (int event = 0; event < PERF_EVENTS; event++) {
+            if (s_perf.fds[event] >= 0) {
+                printf(" %10.3f", counts[region][event]);
+            } else {
+                printf(" %10s", "-");
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "-p") == 0) {
+        s_counting = perf_open(&s_perf) > 0;
+        if (!s_counting) {
+            fprintf(stderr, "hardware counters unavailable; timing only\n");
+        }
+        argv++;
+        argc--;
+    }
+    size_t side = argc > 1 ? strtoul(argv[1], NULL, 10) : 2048;
+    g_board_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+    if (side < SNAKE_LEN + 4) {
+        fprintf(stderr, "board side must be at least %d\n", SNAKE_LEN + 4);
+        return 1;
+    }
+    static const char* names[] = {"row", "tiled", "morton"};
+    static const char* backings[] = {"malloc", "hugetlb", "thp", "mmap"};
+    long sink = 0;
+
+    printf("%zux%zu board, ns per cell (update: ns per step)\n", side, side);
+    printf("%-8s %8s %10s %10s %10s %10s %10s\n", "layout", "pages", "columns",
+           "flood", "windows", "render", "update");
+    if (s_counting) {
+        printf("  %-8s", "per op");
+        for (int event = 0; event < PERF_EVENTS; event++) {
+            printf(" %10s", perf_event_name(event));
+        }
+        printf("\n");
+    }
+    for (int kind = LAYOUT_ROW_MAJOR; kind <= LAYOUT_MORTON; kind++) {
+        g_layout.kind = kind;
+        int* cells = make_board(side);
+        if (!cells) {
+            fprintf(stderr, "could not allocate a %zux%zu board\n", side,
+                    side);
+            return 1;
+        }
+        double counts[REGIONS][PERF_EVENTS] = {{0}};
+        double columns = bench_columns(cells, side, &sink, counts[COLUMNS]);
+        double flood = bench_flood(cells, side, &sink, counts[FLOOD]);
+        double windows =
+            bench_windows(cells, side, &sink, counts[WINDOWS_REGION]);
+        double render = bench_render(cells, side, &sink, counts[RENDER]);
+        double steps = bench_update(cells, side, &sink, counts[UPDATE]);
+        printf("%-8s %8s %10.2f %10.2f %10.3f %10.2f %10.1f\n", names[kind],
+               backings[board_backing(cells)], columns, flood, windows, render,
+               steps);
+        if (s_counting) {
+            print_counts(counts);
+        }
+        board_free(cells);
+    }
+    perf_close(&s_perf);
+    layout_free(&g_layout);
+    game_shutdown();
+    return sink == 0;
+}
@@ -0,0 +1,798 @@
+// Differential tester: plays random games on the engine and on the reference
+// model in test/reference_game.c and reports the first tick where they
+// disagree, with the key string shrunk to a minimal reproducer.
+//
+// Usage: difftest [--trackers | --items | --batch] [GAMES [SEED]]
+// Each game draws a board (walls, snake, sometimes a corrupted board string),
+// a food seed, a key string, growth and wrap rules, a cell layout and lazy
+// or eager initialization, and plays it through `update` tick by tick or
+// through `advance` in random chunks. After every tick (every chunk for
+// `advance`) the engine's state is hashed and checked against the reference
+// model's state at the same tick. Games stepped with `update` are also
+// encoded as observation planes after every tick (see observation.h),
+// including the tick on which the snake runs off a borderless board. Build
+// with `make difftest`.
+//
+// With --trackers, each game is instead played through `update` with the
+// incremental connectivity tracker and distance field following the cell
+// log, and after every tick both are checked against trackers rebuilt from
+// the board: the reachable counts from the head and from every cell, and
+// the distance of every cell.
+//
+// With --items, each game also has extra foods and power-ups, which the
+// reference model does not know, so it is played on the engine twice: with
+// `update` tick by tick and with `advance` in random chunks, and the two
+// are compared after every chunk, item table included.
+//
+// With --batch, each game is played through `update` and, as a batch of
+// one, through `step_batch` (see batch_env.h), with the food the batch
+// places copied onto the engine's board before every tick. After every tick
+// the two must agree on whether the game is over, the score, the length and
+// the snake's cells.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/batch_env.h"
+#include "../src/board_layout.h"
+#include "../src/common.h"
+#include "../src/connectivity.h"
+#include "../src/distance_field.h"
+#include "../src/fast_forward.h"
+#include "../src/game.h"
+#include "../src/game_setup.h"
+#include "../src/items.h"
+#include "../src/neighbor_table.h"
+#include "../src/observation.h"
+#include "../src/rules.h"
+#include "reference_game.h"
+
+#define MAX_SIDE 24
+#define MAX_KEYS 400
+#define BOARD_CHARS (MAX_SIDE * (MAX_SIDE * 4 + 1) + 32)
+
+/** One randomly drawn game.
+ * Fields:
+ *  - board: the board string, or "" for the default board.
+ *  - seed: seed for food placement.
+ *  - keys: the key string (U, D, L, R or N for each tick).
+ *  - growing: 1 if the snake grows on eating.
+ *  - growth: segments added per food.
+ *  - wrap: 1 if the board wraps around.
+ *  - foods, powerup_every, powerup_ttl: item rules (see rules.h); with
+ *    more than one food or any power-ups, the engine keeps an item table.
+ *  - kind, lazy: how the engine lays out and initializes its board.
+ *  - chunk_seed: 0 to step with `update`, otherwise seeds the chunk sizes
+ *    handed to `advance`.
+ */
+typedef struct game_case {
+    char board[BOARD_CHARS];
+    unsigned seed;
+    char keys[MAX_KEYS + 1];
+    int growing;
+    unsigned growth;
+    int wrap;
+    unsigned foods;
+    unsigned powerup_every;
+    unsigned powerup_ttl;
+    enum layout_kind kind;
+    int lazy;
+    unsigned chunk_seed;
+} game_case_t;
+
+static uint64_t s_rng;
+
+/** Returns a random number in [0, bound) from the tester's own generator,
+ * so drawing games never disturbs the engine's `rand` sequence.
+ */
+static unsigned draw(unsigned bound) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (unsigned)(s_rng >> 32) % bound;
+}
+
+/** Folds `value` into an FNV-1a hash. */
+static uint64_t mix(uint64_t hash, long value) {
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Hashes the reference model's state. */
+static uint64_t hash_reference(const ref_game_t* game) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = mix(hash, game->game_over);
+    hash = mix(hash, game->score);
+    hash = mix(hash, game->len);
+    hash = mix(hash, game->growth_pending);
+    for (size_t i = 0; i < game->len; i++) {
+        for (int k = 0; k < 3; k++) {
+            hash = mix(hash, game->body[i][k]);
+        }
+    }
+    for (size_t i = 0; i < game->width * game->height; i++) {
+        hash = mix(hash, game->cells[i]);
+    }
+    return hash;
+}
+
+/** Hashes the engine's state the same way. */
+static uint64_t hash_engine(const int* cells, size_t width, size_t height,
+                            const snake_t* snake) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = mix(hash, g_game_over);
+    hash = mix(hash, g_score);
+    hash = mix(hash, snake->snake_len);
+    hash = mix(hash, snake->growth_pending);
+    for (node_t* node = snake->position; node; node = node->next) {
+        int* position = node->data;
+        for (int k = 0; k < 3; k++) {
+            hash = mix(hash, position[k]);
+        }
+    }
+    for (size_t i = 0; i < width * height; i++) {
+        hash = mix(hash, cell_flag_at(cells, width, i));
+    }
+    return hash;
+}
+
+/** Maps a key character to its input. */
+static enum input_key key_input(char key) {
+    switch (key) {
+        case 'U': return INPUT_UP;
+        case 'D': return INPUT_DOWN;
+        case 'L': return INPUT_LEFT;
+        case 'R': return INPUT_RIGHT;
+        default: return INPUT_NONE;
+    }
+}
+
+/** Applies the game's rules to the engine's globals. */
+static void apply_rules(const game_case_t* c) {
+    g_rules.growth = c->growth;
+    g_rules.wrap = c->wrap;
+    g_rules.foods = c->foods;
+    g_rules.powerup_every = c->powerup_every;
+    g_rules.powerup_ttl = c->powerup_ttl;
+    g_layout.kind = c->kind;
+    g_layout.lazy = c->lazy;
+}
+
+/** Plays the game on the reference model, storing the init status in
+ * `status_p` and the state hash after tick `t` in `hashes[t]` (tick 0 being
+ * the starting state). Returns the number of hashes stored, or 0 if the
+ * game cannot be played out (see `ref_game_t.stuck`).
+ */
+static size_t run_reference(const game_case_t* c, int* status_p,
+                            uint64_t* hashes) {
+    apply_rules(c);
+    set_seed(c->seed);
+    ref_game_t game;
+    *status_p = ref_init(&game, c->board[0] ? c->board : NULL);
+    if (*status_p != INIT_SUCCESS || game.stuck) {
+        ref_free(&game);
+        return 0;
+    }
+
+    size_t n = strlen(c->keys);
+    hashes[0] = hash_reference(&game);
+    for (size_t t = 0; t < n && !game.stuck; t++) {
+        ref_update(&game, key_input(c->keys[t]), c->growing);
+        hashes[t + 1] = hash_reference(&game);
+    }
+    int stuck = game.stuck;
+    ref_free(&game);
+    return stuck ? 0 : n + 1;
+}
+
+/** Encodes the engine's board as u8 and f32 planes into buffers of exactly
+ * their size, so that a write past them is caught, and checks the head
+ * plane: one cell set at the head, or none once the head is off the board.
+ * Returns 0 if it holds and -1 if not.
+ */
+static int check_planes(const int* cells, size_t width, size_t height,
+                        snake_t* snake) {
+    size_t count = width * height;
+    unsigned char* planes = malloc(PLANE_COUNT * count);
+    float* floats = malloc(PLANE_COUNT * count * sizeof(float));
+    if (!planes || !floats) {
+        fprintf(stderr, "could not allocate planes\n");
+        exit(2);
+    }
+    encode_planes_u8(cells, width, height, snake, planes);
+    encode_planes_f32(cells, width, height, snake, floats);
+
+    int* head = get_first(snake->position);
+    int on_board = head[0] >= 0 && head[1] >= 0 &&
+                   (size_t)head[0] < height && (size_t)head[1] < width;
+    size_t at = on_board ? width * head[0] + head[1] : count;
+    int status = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned char expected = i == at;
+        if (planes[PLANE_HEAD * count + i] != expected ||
+            floats[PLANE_HEAD * count + i] != expected) {
+            status = -1;
+        }
+    }
+    free(planes);
+    free(floats);
+    return status;
+}
+
+/** Plays the game on the engine and checks it against the reference
+ * model's status and hashes. Returns the first tick whose state differs, or
+ * -1 if the engine matches throughout.
+ */
+static long run_engine(const game_case_t* c, int status,
+                       const uint64_t* hashes) {
+    char board[BOARD_CHARS];
+    strcpy(board, c->board);
+
+    apply_rules(c);
+    set_seed(c->seed);
+    int* cells = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    snake_t snake;
+    int engine_status = initialize_game(&cells, &width, &height, &snake,
+                                        board[0] ? board : NULL);
+    if (engine_status != status || status != INIT_SUCCESS) {
+        teardown(cells, &snake);
+        return engine_status != status ? 0 : -1;
+    }
+
+    long diverged = -1;
+    size_t n = strlen(c->keys);
+    enum input_key inputs[MAX_KEYS];
+    for (size_t t = 0; t < n; t++) {
+        inputs[t] = key_input(c->keys[t]);
+    }
+
+    uint64_t chunk_rng = c->chunk_seed;
+    size_t t = 0;
+    if (hash_engine(cells, width, height, &snake) != hashes[0]) {
+        diverged = 0;
+    }
+    while (diverged < 0 && t < n) {
+        size_t step = 1;
+        if (c->chunk_seed) {
+            chunk_rng = chunk_rng * 6364136223846793005ull + 1;
+            step = 1 + (chunk_rng >> 33) % 64;
+            step = step < n - t ? step : n - t;
+            size_t played =
+                advance(cells, width, height, &snake, inputs + t, step,
+                        c->growing);
+            // a game that ended stays put, as repeated updates leave it
+            step = played < step ? n - t : step;
+        } else {
+            update(cells, width, height, &snake, inputs[t], c->growing);
+        }
+        t += step;
+        if (hash_engine(cells, width, height, &snake) != hashes[t] ||
+            (!c->chunk_seed &&
+             check_planes(cells, width, height, &snake) != 0)) {
+            diverged = t;
+        }
+    }
+    teardown(cells, &snake);
+    return diverged;
+}
+
+/** Returns the first tick at which the engine diverges on `c`, or -1.
+ * Games that cannot be played out count as not diverging.
+ */
+static long divergence(const game_case_t* c) {
+    static uint64_t hashes[MAX_KEYS + 1];
+    int status;
+    if (run_reference(c, &status, hashes) == 0 && status == INIT_SUCCESS) {
+        return -1;
+    }
+    return run_engine(c, status, hashes);
+}
+
+// What the trackers last disagreed on, for the report.
+static char s_mismatch[128];
+
+/** Compares the incremental trackers with ones rebuilt from the board.
+ * Returns 1 and describes the difference in `s_mismatch` if they disagree,
+ * 0 if they agree.
+ */
+static int trackers_differ(connectivity_t* conn, distance_field_t* df,
+                           connectivity_t* fresh_conn,
+                           distance_field_t* fresh_df, const int* cells,
+                           snake_t* snake) {
+    size_t count = conn->width * conn->height;
+    for (size_t i = 0; i < count; i++) {
+        if (distance_to_food(df, i) != distance_to_food(fresh_df, i)) {
+            snprintf(s_mismatch, sizeof(s_mismatch),
+                     "distance of cell %zu: %u, rebuilt %u", i,
+                     distance_to_food(df, i), distance_to_food(fresh_df, i));
+            return 1;
+        }
+    }
+
+    size_t reach = connectivity_reachable(conn, cells, snake);
+    size_t fresh_reach = connectivity_reachable(fresh_conn, cells, snake);
+    if (reach != fresh_reach) {
+        snprintf(s_mismatch, sizeof(s_mismatch),
+                 "reachable from the head: %zu, rebuilt %zu", reach,
+                 fresh_reach);
+        return 1;
+    }
+    int* tail = get_last(snake->position);
+    size_t tail_index = snake->snake_len > 1
+                            ? conn->width * tail[0] + tail[1]
+                            : NO_NEIGHBOR;
+    for (size_t i = 0; i < count; i++) {
+        reach = connectivity_reachable_from(conn, cells, i, tail_index);
+        fresh_reach =
+            connectivity_reachable_from(fresh_conn, cells, i, tail_index);
+        if (reach != fresh_reach) {
+            snprintf(s_mismatch, sizeof(s_mismatch),
+                     "reachable from cell %zu: %zu, rebuilt %zu", i, reach,
+                     fresh_reach);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Plays the game through `update` with incremental trackers following the
+ * cell log. Returns the first tick after which they disagree with trackers
+ * rebuilt from the board, or -1 if they agree throughout. Games that do
+ * not start or cannot be played out count as agreeing.
+ */
+static long tracker_divergence(const game_case_t* c) {
+    static uint64_t hashes[MAX_KEYS + 1];
+    int status;
+    if (run_reference(c, &status, hashes) == 0) {
+        return -1;
+    }
+
+    char board[BOARD_CHARS];
+    strcpy(board, c->board);
+    apply_rules(c);
+    set_seed(c->seed);
+    int* cells = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    snake_t snake;
+    if (initialize_game(&cells, &width, &height, &snake,
+                        board[0] ? board : NULL) != INIT_SUCCESS) {
+        teardown(cells, &snake);
+        return -1;
+    }
+
+    connectivity_t conn, fresh_conn;
+    distance_field_t df, fresh_df;
+    int ready = connectivity_init(&conn, width, height) == 0;
+    ready &= connectivity_init(&fresh_conn, width, height) == 0;
+    ready &= distance_field_init(&df, width, height) == 0;
+    ready &= distance_field_init(&fresh_df, width, height) == 0;
+    cell_log_t log = {.indices = NULL, .count = 0, .capacity = 0};
+    if (!ready || cell_log_claim(&log) != 0) {
+        fprintf(stderr, "could not set up the trackers\n");
+        exit(2);
+    }
+    connectivity_rebuild(&conn, cells);
+    distance_field_rebuild(&df, cells);
+
+    long diverged = -1;
+    size_t n = strlen(c->keys);
+    for (size_t t = 0; t < n && diverged < 0; t++) {
+        update(cells, width, height, &snake, key_input(c->keys[t]),
+               c->growing);
+        if (g_game_over) {
+            break;
+        }
+        connectivity_apply(&conn, cells, &log);
+        distance_field_apply(&df, cells, &log);
+        connectivity_rebuild(&fresh_conn, cells);
+        distance_field_rebuild(&fresh_df, cells);
+        if (trackers_differ(&conn, &df, &fresh_conn, &fresh_df, cells,
+                            &snake)) {
+            diverged = t + 1;
+        }
+    }
+
+    cell_log_release(&log);
+    free(log.indices);
+    connectivity_free(&conn);
+    connectivity_free(&fresh_conn);
+    distance_field_free(&df);
+    distance_field_free(&fresh_df);
+    teardown(cells, &snake);
+    return diverged;
+}
+
+/** Hashes the item table, for games played with one. */
+static uint64_t hash_items(const items_t* items) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = mix(hash, items->tick);
+    hash = mix(hash, items->boost_left);
+    hash = mix(hash, items->count);
+    for (int kind = 0; kind < ITEM_KINDS; kind++) {
+        hash = mix(hash, items->live[kind]);
+    }
+    for (size_t i = 0; i < items->count; i++) {
+        hash = mix(hash, items->items[i].cell);
+        hash = mix(hash, items->items[i].expires);
+        hash = mix(hash, items->items[i].kind);
+    }
+    return hash;
+}
+
+/** Plays the game with an item table on the engine: with `update` tick by
+ * tick if `hashes` is to be filled in, storing the state hash after tick
+ * `t` in `hashes[t]`, or otherwise with `advance` in chunks drawn from
+ * `c->chunk_seed`, checking each chunk against `expected`. Returns the
+ * number of ticks played when recording, or the first tick that differs
+ * (-1 if none) when checking. Games that do not start play no ticks.
+ */
+static long run_items(const game_case_t* c, uint64_t* hashes,
+                      const uint64_t* expected) {
+    char board[BOARD_CHARS];
+    strcpy(board, c->board);
+    apply_rules(c);
+    set_seed(c->seed);
+    int* cells = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    snake_t snake;
+    items_t items;
+    if (initialize_game(&cells, &width, &height, &snake,
+                        board[0] ? board : NULL) != INIT_SUCCESS ||
+        items_init(&items, cells, width, height) != 0) {
+        teardown(cells, &snake);
+        return hashes ? 0 : -1;
+    }
+    g_items = &items;
+    size_t plain = 0;
+    for (size_t i = 0; i < width * height; i++) {
+        plain += cell_flag_at(cells, width, i) == FLAG_PLAIN_CELL;
+    }
+    // food and power-ups are placed by retrying random cells, so the game
+    // is cut short before a tick could find no plain cell left: each tick
+    // takes at most `growth` cells for the snake and one for a power-up
+    size_t reserved = c->foods + 1;
+    size_t n = strlen(c->keys);
+    size_t most = plain > reserved ? (plain - reserved) / (c->growth + 1) : 0;
+    n = n < most ? n : most;
+    while (items.live[ITEM_FOOD] < c->foods &&
+           items.live[ITEM_FOOD] + 1 < plain) {
+        place_food(cells, width, height);
+    }
+
+    enum input_key inputs[MAX_KEYS];
+    for (size_t t = 0; t < n; t++) {
+        inputs[t] = key_input(c->keys[t]);
+    }
+    uint64_t hash = hash_engine(cells, width, height, &snake) ^
+                    hash_items(&items);
+    long result = -1;
+    if (hashes) {
+        hashes[0] = hash;
+        for (size_t t = 0; t < n; t++) {
+            update(cells, width, height, &snake, inputs[t], c->growing);
+            hashes[t + 1] = hash_engine(cells, width, height, &snake) ^
+                            hash_items(&items);
+        }
+        result = n;
+    } else {
+        result = hash != expected[0] ? 0 : -1;
+        uint64_t chunk_rng = c->chunk_seed;
+        for (size_t t = 0; t < n && result < 0;) {
+            chunk_rng = chunk_rng * 6364136223846793005ull + 1;
+            size_t step = 1 + (chunk_rng >> 33) % 64;
+            step = step < n - t ? step : n - t;
+            size_t played = advance(cells, width, height, &snake, inputs + t,
+                                    step, c->growing);
+            // a game that ended stays put, as repeated updates leave it
+            t += played < step ? n - t : step;
+            if ((hash_engine(cells, width, height, &snake) ^
+                 hash_items(&items)) != expected[t]) {
+                result = t;
+            }
+        }
+    }
+    items_free(&items);
+    teardown(cells, &snake);
+    return result;
+}
+
+/** Returns the first tick at which `advance` and `update` disagree on `c`
+ * with its item rules, or -1 if they agree throughout.
+ */
+static long item_divergence(const game_case_t* c) {
+    static uint64_t hashes[MAX_KEYS + 1];
+    // boards the reference model cannot place food on would hang the engine
+    game_case_t plain = *c;
+    plain.foods = 1;
+    plain.powerup_every = 0;
+    int status;
+    if (run_reference(&plain, &status, hashes) == 0 ||
+        run_items(c, hashes, NULL) == 0) {
+        return -1;
+    }
+    return run_items(c, NULL, hashes);
+}
+
+/** Plays the game through `update` and through `step_batch` side by side.
+ * Returns the first tick after which they disagree, or -1 if they agree
+ * until the game ends. Games that do not start or cannot be played out
+ * count as agreeing.
+ */
+static long batch_divergence(const game_case_t* c) {
+    static uint64_t hashes[MAX_KEYS + 1];
+    int status;
+    if (run_reference(c, &status, hashes) == 0) {
+        return -1;
+    }
+
+    char board[BOARD_CHARS];
+    strcpy(board, c->board);
+    apply_rules(c);
+    set_seed(c->seed);
+    int* cells = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    snake_t snake;
+    if (initialize_game(&cells, &width, &height, &snake,
+                        board[0] ? board : NULL) != INIT_SUCCESS) {
+        teardown(cells, &snake);
+        return -1;
+    }
+    size_t count = width * height;
+    unsigned char* boards = malloc(count);
+    unsigned char* body = malloc(count);
+    batch_env_t env;
+    if (!boards || !body ||
+        batch_env_init(&env, 1, cells, width, height, &snake, c->growing,
+                       c->seed, boards) != 0) {
+        fprintf(stderr, "could not set up the batch\n");
+        exit(2);
+    }
+    size_t plain = 0;
+    for (size_t i = 0; i < count; i++) {
+        plain += cell_flag_at(cells, width, i) == FLAG_PLAIN_CELL;
+    }
+    // `update` places food by retrying random cells, so stop before the
+    // snake could leave no plain cell for it
+    size_t n = strlen(c->keys);
+    size_t most = plain > 2 ? (plain - 2) / (c->growth + 1) : 0;
+    n = n < most ? n : most;
+
+    long diverged = -1;
+    for (size_t t = 0; t < n && diverged < 0; t++) {
+        for (size_t i = 0; i < count; i++) {
+            int flag = cell_flag_at(cells, width, i);
+            if (flag == FLAG_FOOD || boards[i] == FLAG_FOOD) {
+                cells[cell_offset(width, i)] =
+                    boards[i] == FLAG_FOOD ? FLAG_FOOD : FLAG_PLAIN_CELL;
+            }
+        }
+        unsigned char action = key_input(c->keys[t]);
+        step_batch(&env, &action);
+        update(cells, width, height, &snake, action, c->growing);
+        if (env.done[0] != g_game_over) {
+            diverged = t + 1;
+        }
+        if (g_game_over) {
+            break;
+        }
+        // compare the snake's cells rather than the boards: `update` marks
+        // the head plain on a tick it moves onto the tail's old cell
+        memset(body, 0, count);
+        for (node_t* node = snake.position; node; node = node->next) {
+            int* position = node->data;
+            body[width * position[0] + position[1]] = 1;
+        }
+        int differ = env.scores[0] != g_score ||
+                     env.lengths[0] != (unsigned)snake.snake_len;
+        for (size_t i = 0; i < count; i++) {
+            differ |= (boards[i] == FLAG_SNAKE) != body[i];
+        }
+        if (differ) {
+            diverged = t + 1;
+        }
+    }
+
+    batch_env_free(&env);
+    free(boards);
+    free(body);
+    teardown(cells, &snake);
+    return diverged;
+}
+
+/** Appends a run such as "W12" to a board string. */
+static char* put_run(char* out, char letter, int run) {
+    return out + sprintf(out, "%c%d", letter, run);
+}
+
+/** Draws a random board string into `c->board`. */
+static void draw_board(game_case_t* c) {
+    if (draw(8) == 0) {
+        c->board[0] = '\0';
+        return;
+    }
+    int width = 2 + draw(MAX_SIDE - 1);
+    int height = 2 + draw(MAX_SIDE - 1);
+    int walled = draw(4) != 0;
+    unsigned density = draw(30);
+    int snake = draw(width * height);
+
+    static int flags[MAX_SIDE * MAX_SIDE];
+    for (int i = 0; i < width * height; i++) {
+        int row = i / width;
+        int col = i % width;
+        int edge =
+            row == 0 || col == 0 || row == height - 1 || col == width - 1;
+        flags[i] = (walled && edge) || draw(100) < density ? 'W' : 'E';
+    }
+    flags[snake] = 'S';
+
+    char* out = c->board + sprintf(c->board, "B%dx%d", height, width);
+    for (int row = 0; row < height; row++) {
+        *out++ = '|';
+        int col = 0;
+        while (col < width) {
+            int letter = flags[width * row + col];
+            int run = 1;
+            while (col + run < width &&
+                   flags[width * row + col + run] == letter) {
+                run++;
+            }
+            out = put_run(out, letter, run);
+            col += run;
+        }
+    }
+    *out = '\0';
+
+    // now and then corrupt the string to exercise the error paths
+    if (draw(6) == 0) {
+        char* letters = strchr(c->board, '|');
+        size_t len = strlen(letters);
+        size_t at = draw(len);
+        if (letters[at] >= 'A' && letters[at] <= 'Z') {
+            static const char replacements[] = "EWSXe";
+            letters[at] = replacements[draw(sizeof(replacements) - 1)];
+        } else if (letters[at] >= '1' && letters[at] <= '8') {
+            letters[at] += draw(2) ? 1 : -1;
+        }
+    }
+}
+
+/** Draws a random game. */
+static void draw_case(game_case_t* c) {
+    draw_board(c);
+    c->seed = draw(1u << 30);
+    size_t n = 1 + draw(MAX_KEYS);
+    // mostly no input, as in real play
+    for (size_t i = 0; i < n; i++) {
+        c->keys[i] = draw(3) ? 'N' : "UDLR"[draw(4)];
+    }
+    c->keys[n] = '\0';
+    c->growing = draw(2);
+    c->growth = 1 + draw(3);
+    c->wrap = draw(3) == 0;
+    c->foods = 1;
+    c->powerup_every = 0;
+    c->powerup_ttl = 50;
+    c->kind = draw(3);
+    c->lazy = draw(2);
+    c->chunk_seed = draw(2) ? 1 + draw(1u << 30) : 0;
+}
+
+/** Shrinks the key string of a diverging game while it keeps diverging
+ * under `check`: cuts it after the diverging tick, drops ever smaller
+ * blocks of keys, then turns the remaining turns into N where that still
+ * diverges.
+ */
+static void minimize(game_case_t* c, long tick,
+                     long (*check)(const game_case_t*)) {
+    c->keys[tick] = '\0';
+    size_t n = strlen(c->keys);
+    game_case_t trial = *c;
+
+    for (size_t block = n / 2; block > 0; block /= 2) {
+        for (size_t at = 0; at + block <= n;) {
+            trial = *c;
+            memmove(trial.keys + at, trial.keys + at + block,
+                    n - at - block + 1);
+            long t = check(&trial);
+            if (t >= 0) {
+                trial.keys[t] = '\0';
+                *c = trial;
+                n = strlen(c->keys);
+            } else {
+                at += block;
+            }
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (c->keys[i] == 'N') {
+            continue;
+        }
+        trial = *c;
+        trial.keys[i] = 'N';
+        if (check(&trial) >= 0) {
+            *c = trial;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    long (*check)(const game_case_t*) = divergence;
+    if (argc > 1 && strcmp(argv[1], "--trackers") == 0) {
+        check = tracker_divergence;
+        argv++;
+        argc--;
+    } else if (argc > 1 && strcmp(argv[1], "--items") == 0) {
+        check = item_divergence;
+        argv++;
+        argc--;
+    } else if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        check = batch_divergence;
+        argv++;
+        argc--;
+    }
+    unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    s_rng = argc > 2 ? strtoull(argv[2], NULL, 10) : 88172645463325252ull;
+    if (s_rng == 0) {
+        s_rng = 1;
+    }
+    static const char* layouts[] = {"row", "tiled", "morton"};
+    rules_t defaults = g_rules;
+
+    for (unsigned long g = 0; g < games; g++) {
+        game_case_t c;
+        draw_case(&c);
+        if (check == tracker_divergence || check == batch_divergence) {
+            // these follow `update`; `advance` is checked above
+            c.chunk_seed = 0;
+        } else if (check == item_divergence) {
+            c.foods = 1 + draw(3);
+            c.powerup_every = draw(4) ? 2 + draw(30) : 0;
+            c.powerup_ttl = 1 + draw(40);
+            c.chunk_seed = 1 + draw(1u << 30);
+        }
+        long tick = check(&c);
+        if (tick < 0) {
+            continue;
+        }
+
+        minimize(&c, tick, check);
+        tick = check(&c);
+        printf("game %lu diverges at tick %ld\n", g, tick);
+        if (check == tracker_divergence) {
+            printf("  trackers: %s\n", s_mismatch);
+        }
+        printf("  board:  %s\n", c.board[0] ? c.board : "(default)");
+        printf("  seed:   %u\n", c.seed);
+        printf("  keys:   %s\n", c.keys);
+        printf("  rules:  growing=%d growth=%u wrap=%d\n", c.growing,
+               c.growth, c.wrap);
+        if (check == item_divergence) {
+            printf("  items:  foods=%u powerup_every=%u powerup_ttl=%u\n",
+                   c.foods, c.powerup_every, c.powerup_ttl);
+        }
+        printf("  engine: %s, layout=%s lazy=%d\n",
+               check == batch_divergence ? "update and step_batch"
+               : c.chunk_seed            ? "advance"
+                                         : "update",
+               layouts[c.kind], c.lazy);
+        layout_free(&g_layout);
+        game_shutdown();
+        return 1;
+    }
+    g_rules = defaults;
+    layout_free(&g_layout);
+    game_shutdown();
+    printf("%lu games, no divergence\n", games);
+    return 0;
+}
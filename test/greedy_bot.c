@@ -0,0 +1,74 @@
+// Example bot for the plugin interface in src/snake_bot.h: heads for the
+// nearest food as the crow flies, never onto a cell it cannot enter.
+//
+// Build with `make greedy_bot.so` and play with
+// `./snake --bot ./greedy_bot.so 1`, or have it play a batch of games with
+// `./snake-shm --bot ./greedy_bot.so --games 64 PATH`.
+
+#include <stdlib.h>
+
+#include "../src/snake_bot.h"
+
+static int decide(void* state, const snake_bot_view_t* view) {
+    // the nearest food by Manhattan distance
+    long best = -1;
+    size_t food_row = view->head_row;
+    size_t food_col = view->head_col;
+    for (size_t row = 0; row < view->height; row++) {
+        for (size_t col = 0; col < view->width; col++) {
+            if (view->cell(view, row, col) != SNAKE_BOT_FOOD) {
+                continue;
+            }
+            long distance = labs((long)row - (long)view->head_row) +
+                            labs((long)col - (long)view->head_col);
+            if (best < 0 || distance < best) {
+                best = distance;
+                food_row = row;
+                food_col = col;
+            }
+        }
+    }
+
+    static const int steps[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    int move = SNAKE_BOT_NONE;
+    long move_distance = -1;
+    for (int dir = 0; dir < 4; dir++) {
+        long row = (long)view->head_row + steps[dir][0];
+        long col = (long)view->head_col + steps[dir][1];
+        if (row < 0 || col < 0 || row >= (long)view->height ||
+            col >= (long)view->width ||
+            (view->score > 0 && dir == (view->head_dir ^ 1))) {
+            continue;
+        }
+        int cell = view->cell(view, row, col);
+        if (cell != SNAKE_BOT_PLAIN && cell != SNAKE_BOT_FOOD) {
+            continue;
+        }
+        long distance = labs(row - (long)food_row) + labs(col - (long)food_col);
+        if (move_distance < 0 || distance < move_distance) {
+            move_distance = distance;
+            move = dir;
+        }
+    }
+    return move;
+}
+
+// every game is decided on its own; a bot that batches work across games,
+// such as one running a model, would do it here
+static void decide_batch(void* state, const snake_bot_view_t* views,
+                         size_t count, unsigned char* moves) {
+    for (size_t g = 0; g < count; g++) {
+        moves[g] = decide(state, &views[g]);
+    }
+}
+
+static const snake_bot_t greedy_bot = {
+    .abi_version = SNAKE_BOT_ABI_VERSION,
+    .name = "greedy",
+    .decide = decide,
+    .decide_batch = decide_batch,
+};
+
+const snake_bot_t* snake_bot_entry(void) {
+    return &greedy_bot;
+}
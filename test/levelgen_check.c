@@ -0,0 +1,149 @@
+// Checks generated levels (see src/levelgen.h): every one must load as a
+// board, with the snake at (1, 1) and an open cell ahead of it, and every
+// open cell must be reachable from the snake.
+//
+// Usage: levelgen_check [LEVELS [SEED]]
+// Draws LEVELS levels (default 3000) of every kind, with random sizes, room
+// sizes, pillar densities and seeds, writes each with `levelgen_write`,
+// loads it with `decompress_board_str` and flood-fills it from the snake.
+// Sizes `levelgen_init` rejects are skipped. Build with
+// `make levelgen_check`.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/board_layout.h"
+#include "../src/common.h"
+#include "../src/game.h"
+#include "../src/game_setup.h"
+#include "../src/levelgen.h"
+
+#define MAX_SIDE 64
+
+static uint64_t s_rng;
+
+static unsigned draw(unsigned n) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return s_rng % n;
+}
+
+/** Counts the cells that are not walls and those reachable from `start`
+ * without crossing a wall. Returns 0 if they are the same and -1 if not.
+ */
+static int check_connected(const int* cells, size_t width, size_t height,
+                           size_t start) {
+    size_t count = width * height;
+    size_t open = 0;
+    for (size_t i = 0; i < count; i++) {
+        open += cell_flag_at(cells, width, i) != FLAG_WALL;
+    }
+    unsigned char* seen = calloc(count, 1);
+    size_t* stack = malloc(count * sizeof(size_t));
+    if (!seen || !stack) {
+        fprintf(stderr, "could not allocate the flood fill\n");
+        exit(2);
+    }
+    size_t top = 0;
+    size_t reached = 0;
+    stack[top++] = start;
+    seen[start] = 1;
+    while (top > 0) {
+        size_t cell = stack[--top];
+        reached++;
+        size_t row = cell / width;
+        size_t col = cell % width;
+        size_t next[4] = {cell - width, cell + width, cell - 1, cell + 1};
+        int inside[4] = {row > 0, row + 1 < height, col > 0, col + 1 < width};
+        for (int d = 0; d < 4; d++) {
+            if (inside[d] && !seen[next[d]] &&
+                cell_flag_at(cells, width, next[d]) != FLAG_WALL) {
+                seen[next[d]] = 1;
+                stack[top++] = next[d];
+            }
+        }
+    }
+    free(seen);
+    free(stack);
+    return reached == open ? 0 : -1;
+}
+
+/** Generates and checks one level. Returns 0 if it passes or its size is
+ * rejected, and -1 (after saying why) if it fails.
+ */
+static int check_level(enum level_kind kind, size_t height, size_t width,
+                       size_t room, double density, uint64_t seed) {
+    levelgen_t gen;
+    if (levelgen_init(&gen, kind, height, width, room, density, seed) != 0) {
+        return 0;
+    }
+    char* text = NULL;
+    size_t text_length = 0;
+    FILE* out = open_memstream(&text, &text_length);
+    if (!out || levelgen_write(&gen, out) != 0 || fclose(out) != 0) {
+        fprintf(stderr, "could not write the level\n");
+        exit(2);
+    }
+    size_t gen_width = gen.width;
+    size_t gen_height = gen.height;
+    levelgen_free(&gen);
+    text[strcspn(text, "\n")] = '\0';
+
+    int* cells = NULL;
+    size_t board_width;
+    size_t board_height;
+    snake_t snake = {.position = NULL};
+    const char* problem = NULL;
+    if (decompress_board_str(&cells, &board_width, &board_height, &snake,
+                             text) != INIT_SUCCESS) {
+        problem = "does not load";
+    } else if (board_width != gen_width || board_height != gen_height) {
+        problem = "loads at another size";
+    } else {
+        int* head = get_first(snake.position);
+        if (head[0] != 1 || head[1] != 1) {
+            problem = "does not start the snake at (1, 1)";
+        } else if (cell_flag(cells, board_width, 1, 2) != FLAG_PLAIN_CELL) {
+            problem = "has no open cell ahead of the snake";
+        } else if (check_connected(cells, board_width, board_height,
+                                   board_width + 1) != 0) {
+            problem = "has open cells the snake cannot reach";
+        }
+    }
+    free(text);
+    teardown(cells, &snake);
+    if (problem) {
+        static const char* names[] = {"maze", "rooms", "pillars"};
+        printf("%s level %zux%zu (room %zu, density %.2f, seed %llu) %s\n",
+               names[kind], height, width, room, density,
+               (unsigned long long)seed, problem);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned long levels = argc > 1 ? strtoul(argv[1], NULL, 10) : 3000;
+    s_rng = argc > 2 ? strtoull(argv[2], NULL, 10) : 88172645463325252ull;
+    if (s_rng == 0) {
+        s_rng = 1;
+    }
+
+    for (unsigned long i = 0; i < levels; i++) {
+        enum level_kind kind = draw(3);
+        size_t height = draw(MAX_SIDE);
+        size_t width = draw(MAX_SIDE);
+        size_t room = draw(9);
+        double density = draw(101) / 100.0;
+        uint64_t seed = ((uint64_t)draw(1u << 31) << 32) | draw(1u << 31);
+        if (check_level(kind, height, width, room, density, seed) != 0) {
+            layout_free(&g_layout);
+            return 1;
+        }
+    }
+    layout_free(&g_layout);
+    printf("%lu levels, all connected\n", levels);
+    return 0;
+}
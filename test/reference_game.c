@@ -0,0 +1,255 @@
+// Reference model of the game for differential testing.
+//
+// Everything here is written the obvious way: a row-major board of FLAG_*
+// values, the snake as an array of segments, and every cell write `update`
+// makes done in the same order, with none of the engine's tables, layouts or
+// shortcuts. Quirks of the engine that show up in its output (such as the
+// head's cell reading plain right after it follows the tail) are part of the
+// game and are modeled too.
+
+#include "reference_game.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/rules.h"
+
+/** Appends a segment at the tail. Returns 0 on success and -1 if memory
+ * could not be allocated.
+ */
+static int push_segment(ref_game_t* game, int row, int col, int dir) {
+    if (game->len == game->capacity) {
+        size_t capacity = game->capacity ? game->capacity * 2 : 16;
+        int(*body)[3] = realloc(game->body, capacity * sizeof(*body));
+        if (!body) {
+            return -1;
+        }
+        game->body = body;
+        game->capacity = capacity;
+    }
+    game->body[game->len][0] = row;
+    game->body[game->len][1] = col;
+    game->body[game->len][2] = dir;
+    game->len++;
+    return 0;
+}
+
+/** Puts food on a random plain cell, drawing indices exactly as the engine
+ * does. Sets `game->stuck` instead if there is no plain cell.
+ */
+static void ref_place_food(ref_game_t* game) {
+    size_t plain = 0;
+    for (size_t i = 0; i < game->width * game->height; i++) {
+        plain += game->cells[i] == FLAG_PLAIN_CELL;
+    }
+    if (plain == 0) {
+        game->stuck = 1;
+        return;
+    }
+    unsigned index = generate_index(game->width * game->height);
+    while (game->cells[index] != FLAG_PLAIN_CELL) {
+        index = generate_index(game->width * game->height);
+    }
+    game->cells[index] = FLAG_FOOD;
+}
+
+/** Sets up the 20x10 walled default board with the snake at (2, 2). */
+static enum board_init_status ref_default_board(ref_game_t* game) {
+    game->width = 20;
+    game->height = 10;
+    game->cells = malloc(20 * 10 * sizeof(int));
+    for (size_t row = 0; row < 10; row++) {
+        for (size_t col = 0; col < 20; col++) {
+            int edge = row == 0 || col == 0 || row == 9 || col == 19;
+            game->cells[20 * row + col] = edge ? FLAG_WALL : FLAG_PLAIN_CELL;
+        }
+    }
+    game->cells[20 * 2 + 2] = FLAG_SNAKE;
+    push_segment(game, 2, 2, INPUT_RIGHT);
+    return INIT_SUCCESS;
+}
+
+/** Reads a board string such as "B3x4|W4|W1S1E1W1|W4", reporting errors in
+ * the same order as `decompress_board_str`.
+ */
+static enum board_init_status ref_decompress(ref_game_t* game,
+                                             const char* board) {
+    const char* p = board;
+    while (*p == '|') {
+        p++;
+    }
+    int is_board = *p == 'B';
+    p++;
+    long height = strtol(p, (char**)&p, 10);
+    if (*p == 'x') {
+        p++;
+    }
+    long width = strtol(p, (char**)&p, 10);
+    game->height = height;
+    game->width = width;
+    game->cells = calloc(width * height + 1, sizeof(int));
+    if (!is_board) {
+        return INIT_ERR_BAD_CHAR;
+    }
+    p = strchr(p, '|');
+
+    long row = 0;
+    long snakes = 0;
+    int snake_row = 0;
+    int snake_col = 0;
+    while (p) {
+        while (*p == '|') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (row >= height) {
+            return INIT_ERR_INCORRECT_DIMENSIONS;
+        }
+        long col = 0;
+        while (*p != '\0' && *p != '|') {
+            int flag;
+            switch (toupper((unsigned char)*p)) {
+                case 'E': flag = FLAG_PLAIN_CELL; break;
+                case 'W': flag = FLAG_WALL; break;
+                case 'S': flag = FLAG_SNAKE; break;
+                default: return INIT_ERR_BAD_CHAR;
+            }
+            p++;
+            long run = 0;
+            while (isdigit((unsigned char)*p)) {
+                run = run * 10 + (*p - '0');
+                p++;
+            }
+            col += run;
+            if (flag == FLAG_SNAKE) {
+                snake_row = row;
+                snake_col = col - 1;
+                snakes += run;
+            }
+            if (col > width) {
+                return INIT_ERR_INCORRECT_DIMENSIONS;
+            }
+            for (long i = col - run; i < col; i++) {
+                game->cells[width * row + i] = flag;
+            }
+        }
+        if (col != width) {
+            return INIT_ERR_INCORRECT_DIMENSIONS;
+        }
+        row++;
+        p = *p ? p : NULL;
+    }
+
+    if (row < height) {
+        return INIT_ERR_INCORRECT_DIMENSIONS;
+    }
+    if (snakes != 1) {
+        return INIT_ERR_WRONG_SNAKE_NUM;
+    }
+    push_segment(game, snake_row, snake_col, INPUT_RIGHT);
+    return INIT_SUCCESS;
+}
+
+/** Starts a game the way `initialize_game` does: reads the board (the
+ * default one if `board` is NULL), resets the score and places the first
+ * food. Free the game with `ref_free` whatever the result.
+ */
+enum board_init_status ref_init(ref_game_t* game, const char* board) {
+    memset(game, 0, sizeof(*game));
+    enum board_init_status status =
+        board ? ref_decompress(game, board) : ref_default_board(game);
+    if (status != INIT_SUCCESS) {
+        return status;
+    }
+    ref_place_food(game);
+    return INIT_SUCCESS;
+}
+
+/** Moves (`row`, `col`) one cell in direction `dir`. Off the edge of a board
+ * that does not wrap, the coordinate that changed becomes -1.
+ */
+static void ref_step(const ref_game_t* game, int* row, int* col, int dir) {
+    int* coord = dir == INPUT_UP || dir == INPUT_DOWN ? row : col;
+    int size = coord == row ? (int)game->height : (int)game->width;
+    int next = *coord + (dir == INPUT_UP || dir == INPUT_LEFT ? -1 : 1);
+    if (next < 0 || next >= size) {
+        next = g_rules.wrap ? (next + size) % size : -1;
+    }
+    *coord = next;
+}
+
+/** Advances the game by one tick, as `update` does. */
+void ref_update(ref_game_t* game, enum input_key input, int growing) {
+    if (game->game_over) {
+        return;
+    }
+    size_t width = game->width;
+    int* head = game->body[0];
+    int previous[2] = {head[0], head[1]};
+    int old_tail[3] = {game->body[game->len - 1][0],
+                       game->body[game->len - 1][1],
+                       game->body[game->len - 1][2]};
+
+    // once the snake has eaten, turning back on itself is ignored
+    if (game->score != 0 && input != INPUT_NONE &&
+        (int)input == (head[2] ^ 1)) {
+        input = head[2];
+    }
+    if (input != INPUT_NONE) {
+        head[2] = input;
+    }
+    ref_step(game, &head[0], &head[1], head[2]);
+
+    if (head[0] < 0 || head[1] < 0 ||
+        game->cells[width * head[0] + head[1]] == FLAG_WALL) {
+        game->game_over = 1;
+        return;
+    }
+    int* tail = game->body[game->len - 1];
+    if (game->cells[width * head[0] + head[1]] == FLAG_SNAKE &&
+        (tail[0] != head[0] || tail[1] != head[1] ||
+         game->growth_pending > 0)) {
+        game->game_over = 1;
+        return;
+    }
+
+    if (game->cells[width * head[0] + head[1]] == FLAG_FOOD) {
+        game->score++;
+        if (growing) {
+            game->growth_pending += g_rules.growth;
+        }
+        ref_place_food(game);
+    }
+
+    game->cells[width * previous[0] + previous[1]] = FLAG_PLAIN_CELL;
+    game->cells[width * head[0] + head[1]] = FLAG_SNAKE;
+
+    for (size_t i = 1; i < game->len; i++) {
+        int* segment = game->body[i];
+        int row = segment[0];
+        int col = segment[1];
+        ref_step(game, &segment[0], &segment[1], segment[2]);
+        game->cells[width * row + col] = FLAG_PLAIN_CELL;
+        game->cells[width * segment[0] + segment[1]] = FLAG_SNAKE;
+    }
+
+    if (game->growth_pending > 0 &&
+        push_segment(game, old_tail[0], old_tail[1], old_tail[2]) == 0) {
+        game->cells[width * old_tail[0] + old_tail[1]] = FLAG_SNAKE;
+        game->growth_pending--;
+    }
+
+    for (size_t i = game->len - 1; i > 0; i--) {
+        game->body[i][2] = game->body[i - 1][2];
+    }
+}
+
+/** Frees the game's board and body. */
+void ref_free(ref_game_t* game) {
+    free(game->cells);
+    free(game->body);
+    memset(game, 0, sizeof(*game));
+}
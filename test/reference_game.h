@@ -0,0 +1,40 @@
+#ifndef REFERENCE_GAME_H
+#define REFERENCE_GAME_H
+
+#include <stddef.h>
+
+#include "../src/common.h"
+#include "../src/game_setup.h"
+
+/** Reference game struct. A deliberately plain model of the game, written
+ * straight from the rules, that the optimized engine is tested against.
+ * Fields:
+ *  - cells: FLAG_* value of every cell, row-major.
+ *  - width, height: dimensions of the board.
+ *  - body: {row, col, dir} of each segment, head first.
+ *  - len: number of segments.
+ *  - capacity: number of segments that fit in `body`.
+ *  - growth_pending: segments still to be added at the tail.
+ *  - score: number of foods eaten.
+ *  - game_over: 1 once the game has ended.
+ *  - stuck: 1 if food had to be placed with no plain cell left, where the
+ *    engine would search for one forever.
+ */
+typedef struct ref_game {
+    int* cells;
+    size_t width;
+    size_t height;
+    int (*body)[3];
+    size_t len;
+    size_t capacity;
+    unsigned growth_pending;
+    int score;
+    int game_over;
+    int stuck;
+} ref_game_t;
+
+enum board_init_status ref_init(ref_game_t* game, const char* board);
+void ref_update(ref_game_t* game, enum input_key input, int growing);
+void ref_free(ref_game_t* game);
+
+#endif
@@ -0,0 +1,188 @@
+// Drives snake-shm over its shared-memory channel the way an agent would,
+// and checks every step against `step_batch` run in this process.
+//
+// Usage: shm_agent [--bot BOT.so] [GAMES [STEPS [SEED]]]
+// Starts ./snake-shm with GAMES games (default 16) seeded with SEED
+// (default 1), opens its channel, and steps STEPS times (default 2000) with
+// random actions, some of them out of range. After each step the boards,
+// rewards, done flags and scores in the channel must match a local batch of
+// the same games. Then it closes the channel and checks that snake-shm
+// exits cleanly and removes the file. With --bot, snake-shm is started with
+// the bot as well, and the actions it played must be the ones the bot picks
+// for the local games. Build with `make shm_agent`.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/batch_env.h"
+#include "../src/bot_plugin.h"
+#include "../src/common.h"
+#include "../src/game_setup.h"
+#include "../src/shm_channel.h"
+
+// how long to wait for snake-shm to set up its channel
+#define OPEN_TIMEOUT_MS 10000
+
+static pid_t s_server = -1;
+
+static void fail(const char* message) {
+    printf("%s\n", message);
+    if (s_server > 0) {
+        kill(s_server, SIGKILL);
+        waitpid(s_server, NULL, 0);
+    }
+    exit(1);
+}
+
+/** Starts snake-shm serving `games` games on `path`. */
+static void start_server(const char* path, long games, unsigned seed,
+                         const char* bot_path) {
+    char games_arg[32];
+    char seed_arg[32];
+    snprintf(games_arg, sizeof(games_arg), "%ld", games);
+    snprintf(seed_arg, sizeof(seed_arg), "%u", seed);
+    s_server = fork();
+    if (s_server < 0) {
+        fail("could not fork");
+    }
+    if (s_server == 0) {
+        if (bot_path) {
+            execl("./snake-shm", "snake-shm", "--games", games_arg, "--seed",
+                  seed_arg, "--bot", bot_path, path, (char*)NULL);
+        } else {
+            execl("./snake-shm", "snake-shm", "--games", games_arg, "--seed",
+                  seed_arg, path, (char*)NULL);
+        }
+        printf("could not run ./snake-shm: %s\n", strerror(errno));
+        _exit(127);
+    }
+}
+
+/** Opens the channel at `path` once snake-shm has made it ready. */
+static void open_channel(shm_channel_t* ch, const char* path) {
+    struct timespec pause = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (int waited = 0; shm_channel_open(ch, path) != 0; waited++) {
+        if ((errno != EAGAIN && errno != ENOENT) ||
+            waited == OPEN_TIMEOUT_MS ||
+            waitpid(s_server, NULL, WNOHANG) != 0) {
+            fail("could not open the channel");
+        }
+        nanosleep(&pause, NULL);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* bot_path = NULL;
+    if (argc > 2 && strcmp(argv[1], "--bot") == 0) {
+        bot_path = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    long games = argc > 1 ? atol(argv[1]) : 16;
+    long steps = argc > 2 ? atol(argv[2]) : 2000;
+    unsigned seed = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    if (games < 1 || steps < 0) {
+        printf("usage: shm_agent [--bot BOT.so] [GAMES [STEPS [SEED]]]\n");
+        return 1;
+    }
+
+    // the same games as snake-shm plays, on snake-shm's default board
+    int* cells;
+    size_t width;
+    size_t height;
+    snake_t snake;
+    if (initialize_game(&cells, &width, &height, &snake, NULL) !=
+        INIT_SUCCESS) {
+        fail("could not set up the board");
+    }
+    size_t board_bytes = width * height;
+    unsigned char* boards = malloc(games * board_bytes);
+    unsigned char* actions = malloc(games);
+    int* before = malloc(games * sizeof(int));
+    snake_bot_view_t* views = malloc(games * sizeof(snake_bot_view_t));
+    batch_env_t env;
+    if (!boards || !actions || !before || !views ||
+        batch_env_init(&env, games, cells, width, height, &snake, 1, seed,
+                       boards) != 0) {
+        fail("could not allocate the games");
+    }
+    bot_plugin_t bot = {.handle = NULL, .bot = NULL, .state = NULL};
+    if (bot_path && bot_plugin_load(&bot, bot_path, width, height) != 0) {
+        printf("could not load bot: %s\n", bot_plugin_error());
+        return 1;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/shm_agent.%ld", (long)getpid());
+    start_server(path, games, seed, bot_path);
+    shm_channel_t ch;
+    open_channel(&ch, path);
+    if (ch.header->count != games || ch.header->width != width ||
+        ch.header->height != height) {
+        fail("the channel does not hold the games asked for");
+    }
+
+    srand(seed);
+    for (long t = 0; t < steps; t++) {
+        for (long g = 0; g < games; g++) {
+            // one in eight is out of range and must count as INPUT_NONE
+            actions[g] = rand() % (INPUT_NONE + 4);
+            ch.actions[g] = actions[g];
+            before[g] = env.done[g] ? 0 : env.scores[g];
+        }
+        shm_channel_signal(&ch, SHM_REQUEST);
+        if (bot_path) {
+            bot_view_batch(views, &env);
+            bot_plugin_decide_batch(&bot, views, games, actions);
+        }
+        step_batch(&env, actions);
+        if (shm_channel_wait(&ch, SHM_RESPONSE) != 0) {
+            printf("snake-shm exited at step %ld\n", t + 1);
+            fail("snake-shm went away");
+        }
+
+        for (long g = 0; g < games; g++) {
+            if ((bot_path && ch.actions[g] != actions[g]) ||
+                ch.rewards[g] != env.scores[g] - before[g] ||
+                ch.done[g] != env.done[g] || ch.scores[g] != env.scores[g]) {
+                printf("game %ld differs at step %ld\n", g, t + 1);
+                fail("snake-shm and step_batch disagree");
+            }
+        }
+        if (memcmp(ch.boards, boards, games * board_bytes) != 0) {
+            printf("boards differ at step %ld\n", t + 1);
+            fail("snake-shm and step_batch disagree");
+        }
+    }
+
+    atomic_store(&ch.header->closing, 1);
+    shm_channel_signal(&ch, SHM_REQUEST);
+    shm_channel_close(&ch);
+    int status;
+    if (waitpid(s_server, &status, 0) != s_server || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        printf("snake-shm did not exit cleanly\n");
+        return 1;
+    }
+    if (access(path, F_OK) == 0) {
+        unlink(path);
+        printf("snake-shm left its channel behind\n");
+        return 1;
+    }
+
+    bot_plugin_unload(&bot);
+    batch_env_free(&env);
+    free(boards);
+    free(actions);
+    free(before);
+    free(views);
+    teardown(cells, &snake);
+    printf("%ld games, %ld steps, no divergence\n", games, steps);
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Round-trip test for the telemetry file format (see src/telemetry.h).
+//
+// Usage: telemetry_roundtrip [TICKS [SEED]]
+// Records TICKS (default 2500) made-up ticks through `telemetry_record` in
+// chunks of CHUNK_ROWS, so that the file ends in a partial chunk, then reads
+// the file back: the header, then each chunk's row count and columns, which
+// are decoded with `telemetry_decode_column` and compared with what was
+// recorded. The columns are drawn so that every chunk of 64 or more rows
+// has one encoded as a single-entry dictionary (length), one as a wider
+// dictionary (turned) and one that only delta encoding fits (latency).
+// Build with `make telemetry_roundtrip`.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/common.h"
+#include "../src/linked_list.h"
+#include "../src/telemetry.h"
+
+#define CHUNK_ROWS 1000
+
+static uint64_t s_rng;
+
+static unsigned draw(unsigned n) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return s_rng % n;
+}
+
+static void fail(const char* message, long tick) {
+    printf("%s", message);
+    if (tick >= 0) {
+        printf(" at tick %ld", tick);
+    }
+    printf("\n");
+    exit(1);
+}
+
+/** Reads a varint from `in` at `*pos`, which is moved past it. */
+static uint64_t read_varint(const unsigned char* in, size_t length,
+                            size_t* pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= length) {
+            fail("file ends inside a varint", -1);
+        }
+        unsigned char byte = in[(*pos)++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    fail("varint too long", -1);
+    return 0;
+}
+
+/** Reads the whole file at `path`, storing its length in `length_p`. */
+static unsigned char* read_file(const char* path, size_t* length_p) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fail("could not reopen the telemetry file", -1);
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+    unsigned char* in = malloc(length > 0 ? length : 1);
+    if (!in || fread(in, 1, length, file) != (size_t)length) {
+        fail("could not read the telemetry file", -1);
+    }
+    fclose(file);
+    *length_p = length;
+    return in;
+}
+
+int main(int argc, char** argv) {
+    long ticks = argc > 1 ? atol(argv[1]) : 2500;
+    s_rng = argc > 2 ? strtoull(argv[2], NULL, 10) : 88172645463325252ull;
+    if (ticks < 1 || s_rng == 0) {
+        printf("usage: telemetry_roundtrip [TICKS [SEED]]\n");
+        return 1;
+    }
+
+    int64_t* expected[TELEMETRY_COLUMNS];
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        expected[c] = malloc(ticks * sizeof(int64_t));
+        if (!expected[c]) {
+            fail("could not allocate the columns", -1);
+        }
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/telemetry_roundtrip.%ld",
+             (long)getpid());
+    telemetry_t tm;
+    if (telemetry_open(&tm, path, CHUNK_ROWS) != 0) {
+        fail("could not open the telemetry file", -1);
+    }
+
+    // a snake of one node, moved about by hand; the recorded length is
+    // `snake_len`, which stays put
+    snake_t snake = {.position = NULL, .snake_len = 3, .growth_pending = 0};
+    int head[3] = {10, 10, 3};
+    insert_first(&snake.position, head, sizeof(head));
+    int* position = get_first(snake.position);
+    int64_t distance = 5;
+    int score = 0;
+    int last_direction = -1;
+    for (long t = 0; t < ticks; t++) {
+        int direction = draw(4) ? last_direction : (int)draw(4);
+        direction = direction < 0 ? 3 : direction;
+        position[0] += direction == 1 ? 1 : direction == 0 ? -1 : 0;
+        position[1] += direction == 3 ? 1 : direction == 2 ? -1 : 0;
+        position[2] = direction;
+        distance = draw(20) ? distance + (int)draw(3) - 1 : -1;
+        distance = distance < 0 && draw(2) ? 7 : distance;
+        score += draw(30) == 0;
+        uint64_t latency = 1000 + draw(1u << 30);
+        telemetry_record(&tm, &snake, distance, score, latency);
+
+        expected[TELEMETRY_HEAD_ROW][t] = position[0];
+        expected[TELEMETRY_HEAD_COL][t] = position[1];
+        expected[TELEMETRY_LENGTH][t] = snake.snake_len;
+        expected[TELEMETRY_DIRECTION][t] = direction;
+        expected[TELEMETRY_TURNED][t] =
+            last_direction >= 0 && direction != last_direction;
+        expected[TELEMETRY_FOOD_DISTANCE][t] = distance;
+        expected[TELEMETRY_SCORE][t] = score;
+        expected[TELEMETRY_LATENCY_NS][t] = latency;
+        last_direction = direction;
+    }
+    if (telemetry_close(&tm) != 0) {
+        fail("could not write the telemetry file", -1);
+    }
+    free(remove_first(&snake.position));
+    free(snake.position);
+
+    size_t length;
+    unsigned char* in = read_file(path, &length);
+    unlink(path);
+    size_t pos = 0;
+    if (length < 6 || memcmp(in, "SNKT", 4) != 0 ||
+        in[4] != TELEMETRY_VERSION || in[5] != TELEMETRY_COLUMNS) {
+        fail("bad header", -1);
+    }
+    pos = 6;
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        size_t name_length = strlen(telemetry_column_names[c]) + 1;
+        if (pos + name_length > length ||
+            memcmp(in + pos, telemetry_column_names[c], name_length) != 0) {
+            fail("bad column name in the header", -1);
+        }
+        pos += name_length;
+    }
+
+    int64_t* values = malloc(CHUNK_ROWS * sizeof(int64_t));
+    if (!values) {
+        fail("could not allocate the columns", -1);
+    }
+    long t = 0;
+    size_t chunks = 0;
+    while (pos < length) {
+        uint64_t rows = read_varint(in, length, &pos);
+        if (rows == 0 || rows > CHUNK_ROWS || t + (long)rows > ticks) {
+            fail("bad chunk row count", t);
+        }
+        for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+            uint64_t column_length = read_varint(in, length, &pos);
+            if (column_length > length - pos) {
+                fail("column runs past the end of the file", t);
+            }
+            const unsigned char* column = in + pos;
+            if (telemetry_decode_column(column, column_length, rows,
+                                        values) != 0) {
+                printf("column %s: ", telemetry_column_names[c]);
+                fail("could not decode", t);
+            }
+            for (uint64_t r = 0; r < rows; r++) {
+                if (values[r] != expected[c][t + r]) {
+                    printf("column %s: ", telemetry_column_names[c]);
+                    fail("value differs", t + r);
+                }
+            }
+
+            // a constant column is a one-entry dictionary of 0-bit indices,
+            // and latencies have too many values for a dictionary; very
+            // short chunks may come out smaller delta encoded
+            int long_chunk = rows >= 64;
+            if (long_chunk && c == TELEMETRY_LENGTH &&
+                (column[0] != TELEMETRY_DICT || column[1] != 1 ||
+                 column_length != 4 || column[3] != 0)) {
+                fail("constant column not encoded as one entry", t);
+            }
+            if (long_chunk && c == TELEMETRY_TURNED &&
+                column[0] != TELEMETRY_DICT) {
+                fail("two-valued column not dictionary encoded", t);
+            }
+            if (long_chunk && c == TELEMETRY_LATENCY_NS &&
+                column[0] != TELEMETRY_DELTA) {
+                fail("latency column not delta encoded", t);
+            }
+            pos += column_length;
+        }
+        t += rows;
+        chunks++;
+    }
+    if (t != ticks) {
+        fail("file ends early", t);
+    }
+
+    free(values);
+    free(in);
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        free(expected[c]);
+    }
+    printf("%ld ticks in %zu chunks, no divergence\n", ticks, chunks);
+    return 0;
+}